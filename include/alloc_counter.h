@@ -0,0 +1,19 @@
+/**
+ * Heap Allocation Counter.
+ *
+ * Counts calls into malloc/calloc/realloc so a code path can be checked
+ * for heap use: read allocCount() before and after it. The debug image
+ * (env:nodemcuv2_debug in platformio.ini) is linked with -Wl,--wrap for
+ * those symbols, which routes every call from the sketch and the core
+ * through the wrappers in alloc_counter.cpp. Other images leave the
+ * allocator alone and the count stays at 0.
+*/
+
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include "Arduino.h"
+
+uint32_t allocCount();
+
+#endif
@@ -0,0 +1,86 @@
+/**
+ * Stackless Coroutines.
+ *
+ * Protothread style: a coroutine is a function returning CO_RUNNING or
+ * CO_DONE whose body sits between CO_BEGIN() and CO_END(). A wait macro
+ * saves the line it stopped at and returns; the next call jumps straight
+ * back there through the switch in CO_BEGIN(). Conversations with the
+ * sensor and the server read as straight code but only ever hold the loop
+ * for one step.
+ *
+ * Locals do not survive a wait, whatever must is kept in a context struct
+ * next to the Coroutine, so the memory of each coroutine is that struct
+ * and is fixed at compile time. Waits cannot be used inside a switch
+ * statement of the body, the case labels would clash.
+*/
+
+#ifndef COROUTINE_H
+#define COROUTINE_H
+
+#include "Arduino.h"
+
+#define CO_RUNNING 0
+#define CO_DONE 1
+
+
+struct CoroutineStats {
+    uint32_t starts;
+    uint32_t resumes;
+    unsigned long max_us;       // longest single resume
+    unsigned long max_ms;       // longest start to finish
+};
+
+
+struct Coroutine {
+    uint16_t line;              // resume point, 0 before the first step
+    unsigned long timer;        // CO_SLEEP() and timeouts
+    unsigned long started;
+    CoroutineStats stats;
+};
+
+typedef int (*CoroutineFunction)();
+
+
+#define CO_BEGIN(co) switch ((co).line) { case 0:
+
+#define CO_END(co) } (co).line = 0; return CO_DONE
+
+/**
+ * Give the loop back, carry on from here on the next resume.
+*/
+#define CO_YIELD(co) \
+    do { (co).line = __LINE__; return CO_RUNNING; case __LINE__:; } while (0)
+
+/**
+ * Return to the loop until cond holds, cond is checked on every resume.
+*/
+#define CO_WAIT_UNTIL(co, cond) \
+    do { (co).line = __LINE__; case __LINE__: if (!(cond)) return CO_RUNNING; } while (0)
+
+#define CO_SLEEP(co, ms) \
+    do { (co).timer = millis(); CO_WAIT_UNTIL(co, millis() - (co).timer >= (ms)); } while (0)
+
+/**
+ * Finish early, the next start begins from the top.
+*/
+#define CO_EXIT(co) \
+    do { (co).line = 0; return CO_DONE; } while (0)
+
+
+/**
+ * Start a coroutine over from its first step.
+*/
+void startCoroutine(Coroutine &co);
+
+/**
+ * Run one step, timing it.
+ * @return true when the coroutine finished.
+*/
+bool resumeCoroutine(Coroutine &co, CoroutineFunction step);
+
+/**
+ * Print a coroutine's figures, context is the size of its whole state.
+*/
+void printCoroutine(Print &out, const char *name, const Coroutine &co, size_t context);
+
+#endif
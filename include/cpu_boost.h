@@ -0,0 +1,76 @@
+/**
+ * Scoped CPU Clock Boost.
+ *
+ * The ESP8266 runs at 80 MHz and can switch to 160 MHz at any time. A
+ * CpuBoost object raises the clock for the scope it lives in and drops
+ * it again when the outermost one ends, so only the short bursts that
+ * can use the speed pay for it in current:
+ *
+ *   {
+ *       CpuBoost boost(BOOST_SEARCH);
+ *       p = finger_scanner.fingerSearch();
+ *   }
+ *
+ * Every scope is timed with micros() into its section, split by the
+ * clock it ran at. Boosting is off by default: the sections around the
+ * sensor commands mostly wait in the software serial for a reply the
+ * sensor computes, so they are only timed at the base clock until a
+ * boostOn run shows a gain worth the port re-timing.
+ *
+ * Peripherals timed in CPU cycles must be re-timed after a switch, see
+ * setCpuBoostHook(). The cycle counter also runs twice as fast while
+ * boosted; cpuBoostSkew() lets profileCycles() count at the base clock.
+*/
+
+#ifndef CPU_BOOST_H
+#define CPU_BOOST_H
+
+#include "Arduino.h"
+
+#define CPU_BASE_MHZ 80
+#define CPU_BOOST_MHZ 160
+
+enum BoostSection : uint8_t { BOOST_CONVERT, BOOST_SEARCH, BOOST_MODEL, BOOST_SECTIONS };
+
+
+struct BoostTiming {
+    uint32_t runs;
+    unsigned long max_us;
+    uint64_t total_us;
+};
+
+
+class CpuBoost {
+    public:
+        explicit CpuBoost(BoostSection section);
+        ~CpuBoost();
+
+        CpuBoost(const CpuBoost &) = delete;
+        CpuBoost &operator=(const CpuBoost &) = delete;
+
+    private:
+        BoostSection section;
+        bool boosted;
+        unsigned long started_us;
+};
+
+
+/**
+ * Boost or only time the sections, off by default.
+*/
+void setCpuBoost(bool enabled);
+
+/**
+ * Called after every clock switch, e.g. to re-time a software serial.
+*/
+void setCpuBoostHook(void (*changed)());
+
+/**
+ * Cycles counted beyond the base clock while boosted.
+*/
+uint32_t cpuBoostSkew();
+
+void resetCpuBoostStats();
+void printCpuBoostStats(Print &out);
+
+#endif
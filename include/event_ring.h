@@ -0,0 +1,117 @@
+/**
+ * ISR to Loop Event Ring.
+ *
+ * Interrupt handlers must not touch the scheduler, the screen or the
+ * server link. They push a small event here instead and the loop picks
+ * it up: a single producer, single consumer ring with the size fixed at
+ * compile time. The producer only writes head and the consumer only
+ * writes tail, both 8 bit so each store is atomic; compiler barriers
+ * keep the slot write before the head store and the slot read before the
+ * tail store, no interrupts are masked.
+ *
+ * The ISR stamps each event with micros(), the consumer's micros() at
+ * dispatch minus the stamp is the latency from the edge to its handler.
+ * Events that find the ring full are dropped and counted.
+*/
+
+#ifndef EVENT_RING_H
+#define EVENT_RING_H
+
+#include "Arduino.h"
+
+#define EVENT_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+enum EventType : uint8_t {
+    EVENT_FINGER_TOUCH,
+};
+
+
+struct Event {
+    uint8_t type;
+    uint8_t arg;
+    unsigned long stamp;    // micros() in the ISR
+};
+
+
+template <uint8_t SIZE>
+class EventRing {
+    static_assert(SIZE >= 2 && SIZE <= 128 && (SIZE & (SIZE - 1)) == 0,
+                  "EventRing size must be a power of two up to 128");
+
+    public:
+        /**
+         * Producer side, call from the ISR only.
+         * Forced inline so the code lands in the IRAM_ATTR handler, an
+         * out of line copy would sit in flash and crash on a touch while
+         * the flash cache is off (EEPROM commit). micros() is in IRAM.
+         * @return false if the ring was full and the event was dropped.
+        */
+        inline __attribute__((always_inline)) bool push(uint8_t type, uint8_t arg = 0) {
+            uint8_t h = head;
+            uint8_t used = (uint8_t)(h - tail);
+            if (used >= SIZE) {
+                overflows++;
+                return false;
+            }
+
+            Event &event = slots[h & (SIZE - 1)];
+            event.type = type;
+            event.arg = arg;
+            event.stamp = micros();
+            EVENT_BARRIER();
+            head = h + 1;
+
+            pushed++;
+            if (used + 1 > peak) {
+                peak = used + 1;
+            }
+            return true;
+        }
+
+        /**
+         * Consumer side, call from the loop only.
+         * @return false if there is no event.
+        */
+        bool pop(Event &out) {
+            uint8_t t = tail;
+            if (t == head) {
+                return false;
+            }
+
+            out = slots[t & (SIZE - 1)];
+            EVENT_BARRIER();
+            tail = t + 1;
+            return true;
+        }
+
+        /**
+         * @return true if no event is waiting for the consumer.
+        */
+        bool empty() const {
+            return tail == head;
+        }
+
+        void printStats(Print &out) {
+            out.print("events size=");
+            out.print(SIZE);
+            out.print(" pushed=");
+            out.print(pushed);
+            out.print(" overflows=");
+            out.print(overflows);
+            out.print(" peak=");
+            out.print(peak);
+            out.print("\n");
+        }
+
+        // written by the producer only
+        volatile uint32_t pushed = 0;
+        volatile uint32_t overflows = 0;
+        volatile uint8_t peak = 0;
+
+    private:
+        Event slots[SIZE];
+        volatile uint8_t head = 0;
+        volatile uint8_t tail = 0;
+};
+
+#endif
@@ -0,0 +1,79 @@
+/**
+ * Animation Frame Governor.
+ *
+ * Decides when the idle animation may draw its next frame. The time
+ * between two calls to due() is the work the rest of the loop did in
+ * between (sensor polls, network reads); its running average stretches
+ * the frame interval under load and leaves it at the full rate while the
+ * loop is idle. A frame that falls due while the loop has work queued
+ * (server lines it is about to read, outbox lines, events) is dropped so
+ * that work runs first.
+ *
+ * While the animation is stopped (an overlay, a conversation, idle mode)
+ * due() is not called, and that gap is not loop work. pause() marks the
+ * stop so the next due() starts measuring afresh.
+*/
+
+#ifndef FRAME_GOVERNOR_H
+#define FRAME_GOVERNOR_H
+
+#include "Arduino.h"
+
+#define GOVERNOR_IDLE_US 2000       // average loop work counted as idle
+#define GOVERNOR_LOAD_SCALE 8       // interval added per unit of work above idle
+#define GOVERNOR_AVERAGE_SHIFT 3    // running average over ~8 loop passes
+
+
+struct GovernorStats {
+    uint32_t frames;
+    uint32_t dropped;       // skipped because work was pending
+    uint32_t deferred;      // pushed back by a stretched interval
+    unsigned long max_work_us;
+};
+
+
+class FrameGovernor {
+    public:
+        /**
+         * @param interval frame interval when idle, in ms.
+         * @param max_interval longest interval under load, in ms.
+        */
+        FrameGovernor(unsigned long interval, unsigned long max_interval);
+
+        /**
+         * @param pending queued work is waiting to be handled.
+         * @return true if a frame should be drawn now, call drawn() after.
+        */
+        bool due(unsigned long now_us, bool pending);
+
+        /**
+         * The frame has been sent, its cost is not counted as loop work.
+        */
+        void drawn(unsigned long now_us);
+
+        /**
+         * The animation stopped, the time until the next due() is not
+         * counted as loop work.
+        */
+        void pause() { started = false; }
+
+        unsigned long interval() const { return interval_us / 1000; }
+        unsigned long work() const { return work_us; }
+
+        void resetStats();
+        void printStats(Print &out);
+
+        GovernorStats stats;
+
+    private:
+        unsigned long min_interval_us;
+        unsigned long max_interval_us;
+        unsigned long interval_us;
+        unsigned long work_us = 0;
+        unsigned long last_call_us = 0;
+        unsigned long last_frame_us = 0;
+        bool started = false;
+        bool deferring = false;
+};
+
+#endif
@@ -0,0 +1,91 @@
+/**
+ * CGRAM Glyph Cache.
+ *
+ * The HD44780 has eight user defined characters. Instead of fixing what
+ * lives in each slot at startup, glyphs are requested by bitmap while a
+ * frame is composed: a glyph already resident costs nothing, a missing one
+ * is uploaded into a free slot or into the slot least recently used by an
+ * earlier frame. Slots used by the frame being composed are never evicted,
+ * and neither are slots still shown on the glass: createChar() changes a
+ * slot at once, the cells showing it are only rewritten by the next
+ * refresh(), so the old cells would flash the new glyph. Such a request
+ * is a miss and the cell stays blank for one frame.
+ *
+ * The working set of a frame has to fit the eight slots, otherwise every
+ * frame uploads glyphs again and costs far more on the bus than it saves.
+ *
+ * On top of the cache, sprites can be placed at pixel positions (a cell is
+ * 5 pixels wide) and progress bars can be drawn with 5 steps per cell.
+*/
+
+#ifndef GLYPH_CACHE_H
+#define GLYPH_CACHE_H
+
+#include "Arduino.h"
+#include "lcd_i2c.h"
+#include "lcd_buffer.h"
+
+#define GLYPH_SLOTS 8
+#define GLYPH_ROWS 8
+#define GLYPH_WIDTH 5
+#define GLYPH_NONE -1
+#define LCD_FULL_BLOCK 0xFF // character ROM, no CGRAM needed
+
+
+struct GlyphStats {
+    uint32_t hits;
+    uint32_t uploads;
+    uint32_t evictions;
+    uint32_t misses;    // every slot was pinned or still on the glass
+};
+
+
+class GlyphCache {
+    public:
+        GlyphCache(LcdI2C &lcd, const LcdBuffer &screen);
+
+        /**
+         * Forget the CGRAM contents, e.g. after lcd.init().
+        */
+        void invalidate();
+
+        /**
+         * Start composing a new frame, slots used from now on are pinned
+         * until the next call.
+        */
+        void beginFrame();
+
+        /**
+         * @return the character code (0..7) showing this bitmap, or
+         * GLYPH_NONE if no slot could be freed for it.
+        */
+        int use(const uint8_t bitmap[GLYPH_ROWS]);
+
+        void printStats(Print &out);
+
+        GlyphStats stats;
+
+    private:
+        LcdI2C &lcd;
+        const LcdBuffer &screen;
+        uint8_t bitmaps[GLYPH_SLOTS][GLYPH_ROWS];
+        bool loaded[GLYPH_SLOTS];
+        uint16_t used_in[GLYPH_SLOTS];
+        uint16_t frame = 1;
+};
+
+
+/**
+ * Draw sprites on one row at pixel positions, 0..(LCD_COLS * 5 - 1),
+ * wrapping around the row end. Overlapping sprites are OR-ed, cells
+ * without sprite pixels are cleared.
+*/
+void drawSprites(LcdBuffer &screen, GlyphCache &glyphs, uint8_t row,
+                 const uint8_t *const sprites[], const uint8_t positions[], uint8_t count);
+
+/**
+ * Draw a bar across a whole row filled to value / max.
+*/
+void drawProgress(LcdBuffer &screen, GlyphCache &glyphs, uint8_t row, uint16_t value, uint16_t max);
+
+#endif
@@ -0,0 +1,65 @@
+/**
+ * Heap Telemetry.
+ *
+ * Samples the heap and the loop stack: free heap, largest free block,
+ * fragmentation (how much of the free heap is not in the largest block),
+ * the lowest free heap seen since boot and the loop stack's high-water
+ * mark. A sample is taken on a fixed period and kept in a ring of recent
+ * ones, and the current figures ride along with every heartbeat so the
+ * server can chart them across the fleet.
+ *
+ * The lowest free heap is tracked on every loop pass through track(),
+ * sampling alone would miss short dips.
+*/
+
+#ifndef HEAP_TELEMETRY_H
+#define HEAP_TELEMETRY_H
+
+#include "Arduino.h"
+
+#define HEAP_SAMPLES 16
+#define HEAP_SAMPLE_INTERVAL 60000 // ms, the ring covers the last 16 minutes
+
+
+struct HeapSample {
+    unsigned long at;       // s since boot
+    uint32_t free;
+    uint32_t max_block;
+    uint8_t fragmentation;  // %
+    uint32_t min_free;
+    uint32_t stack_free;    // loop stack never used so far
+};
+
+
+class HeapTelemetry {
+    public:
+        /**
+         * Cheap enough for every loop pass.
+        */
+        void track();
+
+        /**
+         * Read the figures now.
+        */
+        HeapSample measure(unsigned long now);
+
+        /**
+         * Measure and keep the result in the ring.
+        */
+        void sample(unsigned long now);
+
+        /**
+         * Write a sample as "free=.. block=.. frag=.. min=.. stack=..".
+        */
+        void format(const HeapSample &sample, char *text, size_t size);
+
+        void print(Print &out);
+
+    private:
+        HeapSample samples[HEAP_SAMPLES];
+        uint8_t head = 0;
+        uint8_t count = 0;
+        uint32_t min_free = 0xFFFFFFFF;
+};
+
+#endif
@@ -0,0 +1,88 @@
+/**
+ * Idle Power Mode.
+ *
+ * Tracks user and server activity. Once nothing has happened for the
+ * timeout the unit goes idle: the caller puts the modem to sleep between
+ * DTIM beacons, switches the backlight off and polls the sensor slowly.
+ * A finger touch that the sensor poll confirms, a scan found by the slow
+ * poll or a server command wakes it again at once.
+ *
+ * Besides counting sleeps and wakes, the time spent in each mode gives a
+ * current proxy: the estimated average draw from nominal figures for the
+ * two modes. The latency from a touch that woke the unit to the scanner
+ * taking its image is kept as wake-to-scan.
+*/
+
+#ifndef IDLE_MODE_H
+#define IDLE_MODE_H
+
+#include "Arduino.h"
+
+#define IDLE_ACTIVE_MA 80   // nominal draw awake: modem on, backlight, 50 ms polls
+#define IDLE_SLEEP_MA 20    // nominal draw idle: modem sleep, backlight off, slow polls
+
+enum WakeCause : uint8_t { WAKE_TOUCH, WAKE_SCAN, WAKE_SERVER, WAKE_CAUSES };
+
+
+struct IdleStats {
+    uint32_t sleeps;
+    uint32_t wakes[WAKE_CAUSES];
+    uint32_t scans;             // wake-to-scan samples
+    unsigned long last_scan_us;
+    unsigned long max_scan_us;
+    uint64_t total_scan_us;
+    uint64_t idle_ms;
+    uint64_t active_ms;
+};
+
+
+class IdleMode {
+    public:
+        /**
+         * @param timeout ms without activity before going idle.
+        */
+        explicit IdleMode(unsigned long timeout);
+
+        /**
+         * Something happened, restart the inactivity timeout.
+        */
+        void activity(unsigned long now);
+
+        /**
+         * @return true when the unit is awake and the timeout has passed,
+         * call enter() once the hardware is asleep.
+        */
+        bool due(unsigned long now) const;
+
+        void enter(unsigned long now);
+
+        /**
+         * Back to full power.
+         * @param stamp micros() of the event that woke the unit.
+        */
+        void leave(unsigned long now, WakeCause cause, unsigned long stamp);
+
+        /**
+         * The scanner took an image, closes a pending wake-to-scan.
+        */
+        void scanned(unsigned long now_us);
+
+        bool idle() const { return is_idle; }
+
+        void resetStats(unsigned long now);
+        void printStats(Print &out, unsigned long now);
+
+        IdleStats stats;
+
+    private:
+        void account(unsigned long now);
+
+        unsigned long timeout;
+        unsigned long last_activity = 0;
+        unsigned long accounted = 0;    // millis() up to which time is counted
+        unsigned long wake_stamp = 0;
+        bool is_idle = false;
+        bool scan_pending = false;
+};
+
+#endif
@@ -0,0 +1,79 @@
+/**
+ * Liquid Crystal Display Shadow Buffer.
+ *
+ * All screen writes go into a 16x2 copy of the display. refresh() compares
+ * it with what is known to be on the glass and only sends the cells that
+ * changed, one cursor command per run of changed cells.
+ *
+ * Each run is handed to the backend as one writeRun(), see lcd_i2c.h.
+ * When one fails the buffer goes stale and the next refresh() rewrites
+ * every cell.
+ *
+ * For comparison the stats also keep what writing straight through
+ * LiquidCrystal_I2C would have cost: every display byte there is two
+ * nibbles, each written three times as a separate I2C transmission of
+ * address + data byte, LCD_DIRECT_I2C_BYTES_PER_BYTE in total.
+*/
+
+#ifndef LCD_BUFFER_H
+#define LCD_BUFFER_H
+
+#include "Arduino.h"
+#include "lcd_i2c.h"
+
+#define LCD_COLS 16
+#define LCD_ROWS 2
+#define LCD_DIRECT_I2C_BYTES_PER_BYTE 12
+
+
+struct LcdStats {
+    uint32_t frames;        // refresh() calls that sent something
+    uint32_t idle_frames;   // refresh() calls with nothing to send
+    uint32_t sent_bytes;    // display bytes actually sent
+    uint32_t direct_bytes;  // display bytes an unbuffered write would send
+    uint32_t i2c_bytes;     // bytes the backend put on the bus
+    uint32_t busy_us;       // time spent in refresh()
+};
+
+
+class LcdBuffer : public Print {
+    public:
+        explicit LcdBuffer(LcdI2C &lcd);
+
+        void setCursor(uint8_t col, uint8_t row);
+        size_t write(uint8_t c) override;
+        using Print::write;
+
+        /**
+         * Forget what is on the glass, the next refresh() rewrites every
+         * cell. Needed after anything that bypasses the buffer, like
+         * lcd.init() or lcd.clear().
+        */
+        void invalidate();
+
+        /**
+         * Send the changed cells to the display.
+         * @return the number of display bytes sent.
+        */
+        uint16_t refresh();
+
+        /**
+         * @return true if character code c is known to be on the glass.
+        */
+        bool showing(uint8_t c) const;
+
+        void resetStats();
+        void printStats(Print &out);
+
+        LcdStats stats;
+
+    private:
+        LcdI2C &lcd;
+        uint8_t cells[LCD_ROWS][LCD_COLS];
+        uint8_t shown[LCD_ROWS][LCD_COLS];
+        bool stale = true;
+        uint8_t col = 0;
+        uint8_t row = 0;
+};
+
+#endif
@@ -0,0 +1,100 @@
+/**
+ * HD44780 over PCF8574 Liquid Crystal Display Backend.
+ *
+ * Replaces LiquidCrystal_I2C for the 16x2 on the backpack at 0x27.
+ * LiquidCrystal_I2C sends every nibble as three separate Wire
+ * transmissions (data, enable high, enable low). Here the enable pulse is
+ * folded into two expander writes per nibble and a whole row of
+ * characters is packed into a single transmission after its cursor
+ * command, limited only by the Wire buffer. The bus runs in fast mode (400 kHz).
+ *
+ * One expander write takes about 22.5 us there. That covers the enable
+ * pulse, but most instructions run for 37 us, longer with a slow
+ * oscillator. Data bytes rely on the two writes (45 us) before the next
+ * nibble is latched. After a command the transmission is ended and the
+ * execution time is waited out with delayMicroseconds().
+ *
+ * PCF8574 to HD44780 wiring on the backpack:
+ *  P0 RS, P1 RW, P2 EN, P3 backlight, P4..P7 D4..D7
+*/
+
+#ifndef LCD_I2C_H
+#define LCD_I2C_H
+
+#include "Arduino.h"
+#include "Wire.h"
+
+#define LCD_RS 0x01
+#define LCD_EN 0x04
+#define LCD_BACKLIGHT 0x08
+
+#define LCD_I2C_CLOCK 400000
+#define LCD_POWER_UP_MS 50  // Vcc above 4.5 V for 40 ms before the first instruction
+#define LCD_COMMAND_US 50   // 37 us execution time, with room for a slow oscillator
+#define LCD_I2C_BATCH (BUFFER_LENGTH - 4)   // expander bytes per transmission
+
+
+class LcdI2C : public Print {
+    public:
+        LcdI2C(uint8_t address, uint8_t cols, uint8_t rows);
+
+        void init();
+        void backlight();
+        void noBacklight();
+        void clear();
+        void setCursor(uint8_t col, uint8_t row);
+        void createChar(uint8_t slot, const uint8_t bitmap[8]);
+
+        size_t write(uint8_t c) override;
+        using Print::write;
+
+        /**
+         * Position the cursor and write `len` characters in as few
+         * transmissions as the Wire buffer allows.
+         * @return false if a transmission failed, what the glass shows
+         * is then unknown.
+        */
+        bool writeRun(uint8_t col, uint8_t row, const uint8_t *data, uint8_t len);
+
+        /**
+         * Clock a slave that holds SDA low out of its transfer and issue a
+         * STOP, then restart Wire. Called by the backend after a failed
+         * transmission. If the retry fails too the controller is
+         * resynchronized before the next write.
+         * @return true if the bus is idle afterwards.
+        */
+        bool recoverBus();
+
+        /**
+         * With batching off every nibble is sent the LiquidCrystal_I2C
+         * way, kept to benchmark against.
+        */
+        void setBatching(bool enabled) { batching = enabled; }
+
+        uint32_t i2c_bytes = 0;
+        uint32_t transmissions = 0;
+        uint32_t bus_errors = 0;
+        uint32_t recoveries = 0;
+
+    private:
+        void resynchronize();
+        bool ready();
+        bool command(uint8_t value);
+        void send(uint8_t value, uint8_t mode);
+        void queueNibble(uint8_t bits);
+        void queue(uint8_t b);
+        bool transmit();
+
+        uint8_t address;
+        uint8_t cols;
+        uint8_t rows;
+        uint8_t backlight_bit = LCD_BACKLIGHT;
+        uint8_t last_bits = 0;
+        bool batching = true;
+        bool resync = false;
+
+        uint8_t batch[LCD_I2C_BATCH];
+        uint8_t batch_len = 0;
+};
+
+#endif
@@ -0,0 +1,65 @@
+/**
+ * LCD Screens.
+ *
+ * How the client draws its screens: canned texts, the enrollment progress
+ * bar, the idle scan animation and the LCD bring-up. The firmware and the
+ * host report in src/native/lcd_report.cpp both draw through these, so
+ * the golden snapshots cover the code that runs on the device.
+*/
+
+#ifndef LCD_SCREENS_H
+#define LCD_SCREENS_H
+
+#include "Arduino.h"
+#include "lcd_i2c.h"
+#include "lcd_buffer.h"
+#include "glyph_cache.h"
+#include "screen_text.h"
+
+#define SCAN_SPRITES 4
+
+enum ScanMode : uint8_t { SCAN_IDLE, SCAN_ENROLL };
+
+
+/**
+ * The sprites move a whole cell per frame, as they always did, so a frame
+ * needs just the head and the tail glyph. Pixel steps would need up to 18
+ * glyphs per lap position, more than the eight CGRAM slots.
+*/
+struct ScanAnimation {
+    ScanMode mode;
+    uint8_t positions[SCAN_SPRITES];    // pixel columns on the second row, 5 per cell
+};
+
+
+/**
+ * Write a screen from flash into the screen buffer without sending it.
+*/
+void drawScreenText(LcdBuffer &screen, ScreenText text);
+
+/**
+ * Draw a screen and send the characters that changed.
+*/
+void showScreenText(LcdBuffer &screen, ScreenText text);
+
+/**
+ * Show a screen's first line over a progress bar, used while enrolling.
+*/
+void showProgress(LcdBuffer &screen, GlyphCache &glyphs, ScreenText text, uint16_t step, uint16_t steps);
+
+/**
+ * Bring the LCD up with the backlight on and show the start screen.
+*/
+void initDisplay(LcdI2C &lcd, LcdBuffer &screen, GlyphCache &glyphs);
+
+/**
+ * Put the animation back at its first frame.
+*/
+void resetScanAnimation(ScanAnimation &animation);
+
+/**
+ * Draw and send one frame of the scan animation, then advance it.
+*/
+void drawScanFrame(LcdBuffer &screen, GlyphCache &glyphs, ScanAnimation &animation);
+
+#endif
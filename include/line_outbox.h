@@ -0,0 +1,51 @@
+/**
+ * Line Outbox.
+ *
+ * A small queue of protocol lines for the server, sent one per call to
+ * sendNext(). The scheduler calls it on a fixed period, which spaces the
+ * enrollment fields the way the old delay(30) between println()s did
+ * without holding up the loop in between. Lines keep their order with
+ * the heartbeat, which goes through the same queue. Conversations write
+ * their first lines directly, so starting one flushes the queue first.
+*/
+
+#ifndef LINE_OUTBOX_H
+#define LINE_OUTBOX_H
+
+#include "Arduino.h"
+
+#define OUTBOX_LINES 10
+#define OUTBOX_LINE_SIZE 96 // longest line kept, longer ones are cut
+
+
+class LineOutbox {
+    public:
+        /**
+         * @return false if the queue is full and the line was dropped.
+        */
+        bool push(const char *line);
+        bool push(long value);
+
+        /**
+         * Send the oldest line with println().
+         * @return true if a line was sent.
+        */
+        bool sendNext(Print &out);
+
+        /**
+         * Send every queued line now.
+        */
+        void flush(Print &out);
+
+        bool empty() const { return count == 0; }
+        uint8_t size() const { return count; }
+
+        uint32_t dropped = 0;
+
+    private:
+        char lines[OUTBOX_LINES][OUTBOX_LINE_SIZE];
+        uint8_t head = 0;
+        uint8_t count = 0;
+};
+
+#endif
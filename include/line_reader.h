@@ -0,0 +1,43 @@
+/**
+ * Line Reader.
+ *
+ * Collects a protocol line from a stream without waiting for it, unlike
+ * readStringUntil() which blocks up to the stream timeout and allocates
+ * a String. poll() takes what has arrived so far; once the newline is in,
+ * line() holds the text until the next poll(). A carriage return is
+ * dropped, text beyond the buffer is cut and counted.
+*/
+
+#ifndef LINE_READER_H
+#define LINE_READER_H
+
+#include "Arduino.h"
+
+#define LINE_READER_SIZE 96
+
+
+class LineReader {
+    public:
+        /**
+         * Read whatever is available.
+         * @return true when a whole line is in line().
+        */
+        bool poll(Stream &in);
+
+        const char *line() const { return text; }
+
+        /**
+         * @return true while part of a line has been read.
+        */
+        bool partial() const { return !complete && (length > 0 || cut); }
+
+        uint32_t truncated = 0;
+
+    private:
+        char text[LINE_READER_SIZE];
+        uint8_t length = 0;
+        bool complete = false;
+        bool cut = false;
+};
+
+#endif
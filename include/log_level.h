@@ -0,0 +1,69 @@
+/**
+ * Compile-time Log Levels.
+ *
+ * Diagnostics are written with a level macro instead of calling the log
+ * directly:
+ *
+ *   LOG_INFO("\n[i] Connected !");
+ *   LOG_DEBUGLN("Image taken");
+ *
+ * Levels above LOG_LEVEL expand to an empty statement, their arguments,
+ * string literals included, are never compiled into the image and cost
+ * nothing at run time. Enabled levels print to debug_log, see log_ring.h.
+ *
+ *   LOG_LEVEL_ERROR  failures worth knowing about in the field
+ *   LOG_LEVEL_INFO   connection and mode changes, boot progress
+ *   LOG_LEVEL_DEBUG  every sensor step and scan timing
+ *
+ * Builds default to LOG_LEVEL_DEBUG, release builds pass -D LOG_LEVEL=...
+*/
+
+#ifndef LOG_LEVEL_H
+#define LOG_LEVEL_H
+
+#include "log_ring.h"
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_DEBUG 3
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+/**
+ * For output that is more than a print, e.g. a report after a prefix:
+ * if (LOG_ENABLED(LOG_LEVEL_INFO)) { ... } is folded away when off.
+*/
+#define LOG_ENABLED(level) (LOG_LEVEL >= (level))
+
+#define LOG_NOTHING() do {} while (0)
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) debug_log.print(__VA_ARGS__)
+#define LOG_ERRORLN(...) debug_log.println(__VA_ARGS__)
+#else
+#define LOG_ERROR(...) LOG_NOTHING()
+#define LOG_ERRORLN(...) LOG_NOTHING()
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) debug_log.print(__VA_ARGS__)
+#define LOG_INFOLN(...) debug_log.println(__VA_ARGS__)
+#else
+#define LOG_INFO(...) LOG_NOTHING()
+#define LOG_INFOLN(...) LOG_NOTHING()
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) debug_log.print(__VA_ARGS__)
+#define LOG_DEBUGLN(...) debug_log.println(__VA_ARGS__)
+#else
+#define LOG_DEBUG(...) LOG_NOTHING()
+#define LOG_DEBUGLN(...) LOG_NOTHING()
+#endif
+
+extern LogRing debug_log;
+
+#endif
@@ -0,0 +1,73 @@
+/**
+ * Buffered Debug Log.
+ *
+ * Diagnostics are printed into a RAM ring instead of straight to Serial.
+ * At 115200 baud the UART FIFO takes 128 bytes, ~11 ms of text; once it
+ * is full every further Serial.print() spins until there is room, which
+ * stalls the loop. The ring takes the text right away and drain() passes
+ * on only as much as the sink can take without waiting. Text that finds
+ * the ring full is dropped and counted.
+ *
+ * While the ring is empty, writes that fit go straight to the sink. The
+ * sink can be switched at run time, e.g. to the server link.
+ *
+ * The server link carries protocol lines as well. Routed there with a
+ * prefix, the log passes on whole lines only, each one starting with the
+ * prefix, and only while the gate says no protocol exchange is under
+ * way. Empty lines are dropped. A "\n[i] ..." message is sent once the
+ * next one begins. A line longer than LOG_LINE_MAX is sent as several
+ * prefixed lines, so no line needs more room than a sink can offer.
+*/
+
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include "Arduino.h"
+
+#define LOG_RING_SIZE 1024
+#define LOG_PREFIX_SIZE 8
+#define LOG_LINE_MAX 128    // longest routed line, prefix and newline not counted
+
+typedef bool (*LogGate)();
+
+
+class LogRing : public Print {
+    public:
+        explicit LogRing(Print &sink);
+
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t *buffer, size_t size) override;
+        using Print::write;
+
+        /**
+         * Pass on what the sink takes without blocking.
+        */
+        void drain();
+
+        /**
+         * Send the rest of the log to another sink.
+         * @param prefix starts every line, whole lines only, or nullptr
+         * to pass text on as it comes.
+         * @param gate lines wait while it returns false, may be nullptr.
+        */
+        void route(Print &sink, const char *prefix = nullptr, LogGate gate = nullptr);
+
+        void resetStats();
+        void printStats(Print &out);
+
+        uint32_t dropped = 0;   // bytes
+        uint32_t written = 0;   // bytes accepted
+        size_t peak = 0;
+
+    private:
+        bool drainLine();
+
+        Print *sink;
+        char prefix[LOG_PREFIX_SIZE] = "";
+        LogGate gate = nullptr;
+        uint8_t data[LOG_RING_SIZE];
+        size_t head = 0;
+        size_t count = 0;
+};
+
+#endif
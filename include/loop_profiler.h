@@ -0,0 +1,75 @@
+/**
+ * Loop Latency Profiler.
+ *
+ * Times every loop() pass and every scheduler task with the CPU cycle
+ * counter and keeps a log2 histogram per section: bucket i counts the
+ * passes that took from 2^i up to 2^(i+1) microseconds, bucket 0 also
+ * takes everything below 2 us. The longest pass of each section and the
+ * most recent stalls (which section, how long, when) are kept as well.
+ *
+ * The cycle counter wraps after ~53 s at 80 MHz, far above any pass.
+*/
+
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+#include "Arduino.h"
+#include "cpu_boost.h"
+
+#define PROFILE_SECTIONS 13
+#define PROFILE_LOOP 0          // section of the whole loop() pass, 1..10 are scheduler tasks
+#define PROFILE_COMMAND 11      // server command, arrival to dispatch
+#define PROFILE_EVENT 12        // ISR event, edge to handler
+#define PROFILE_BUCKETS 24      // up to 2^24 us, ~16 s
+#define PROFILE_STALL_US 20000  // passes this long are logged as stalls
+#define PROFILE_STALLS 8
+
+
+/**
+ * Cycles since boot at the base clock, converted with cyclesToMicros().
+ * Boosted stretches are scaled down, see cpu_boost.h, so passes that
+ * contain a whole boost are timed right.
+*/
+inline uint32_t profileCycles() {
+    return ESP.getCycleCount() - cpuBoostSkew();
+}
+
+inline unsigned long cyclesToMicros(uint32_t cycles) {
+    return cycles / ESP.getCpuFreqMHz();
+}
+
+
+struct ProfileSection {
+    const char *name;
+    uint32_t count;
+    unsigned long max_us;
+    uint64_t total_us;
+    uint32_t buckets[PROFILE_BUCKETS];
+};
+
+
+struct Stall {
+    uint8_t section;
+    unsigned long us;
+    unsigned long at;   // millis() when it ended
+};
+
+
+class LoopProfiler {
+    public:
+        LoopProfiler();
+
+        void name(uint8_t section, const char *name);
+        void record(uint8_t section, unsigned long us);
+
+        void reset();
+        void print(Print &out);
+
+    private:
+        ProfileSection sections[PROFILE_SECTIONS];
+        Stall stalls[PROFILE_STALLS];
+        uint8_t stall_head = 0;
+        uint8_t stall_count = 0;
+};
+
+#endif
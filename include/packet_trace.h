@@ -0,0 +1,119 @@
+/**
+ * Fingerprint Scanner Packet Tracer.
+ *
+ * A transparent Stream that sits between Adafruit_Fingerprint and the
+ * sensor UART. Every command packet written by the library is matched to
+ * the acknowledge packet that answers it, and the pair is recorded into a
+ * small RAM ring buffer together with the byte counts and the round trip
+ * time in microseconds. Data packets that follow an acknowledge, like a
+ * template upload, count towards its record until the next command.
+ *
+ * Packet layout (both directions):
+ *  0xEF 0x01 | addr[4] | pid | len_hi len_lo | payload[len - 2] | sum[2]
+ * The first payload byte is the instruction code on a command packet and
+ * the confirmation code on an acknowledge packet.
+*/
+
+#ifndef PACKET_TRACE_H
+#define PACKET_TRACE_H
+
+#include "Arduino.h"
+
+#define TRACE_RING_SIZE 32      // recorded command/reply pairs
+#define TRACE_SUMMARY_SIZE 16   // distinct instruction codes summarized
+#define TRACE_NO_REPLY 0xFF     // reply code of a command that timed out
+
+
+struct TraceRecord {
+    uint8_t command;        // instruction code sent to the sensor
+    uint8_t reply;          // confirmation code, TRACE_NO_REPLY if none
+    uint16_t tx_bytes;      // bytes written for this command
+    uint16_t rx_bytes;      // bytes read back until the next command, data packets included
+    uint32_t duration_us;   // first command byte to last reply byte
+};
+
+
+struct TraceSummary {
+    uint8_t command;
+    uint16_t count;
+    uint16_t failures;      // replies other than FINGERPRINT_OK
+    uint32_t total_us;
+    uint32_t max_us;
+};
+
+
+/**
+ * Parses one direction of the sensor byte stream into packets.
+ * feed() returns true when the byte completed a packet.
+*/
+class PacketParser {
+    public:
+        void reset();
+        bool feed(uint8_t b);
+
+        uint8_t pid;
+        uint8_t code;
+
+    private:
+        uint16_t index = 0;
+        uint16_t length = 0;
+};
+
+
+class TracedStream : public Stream {
+    public:
+        explicit TracedStream(Stream &inner);
+
+        // Stream
+        int available() override;
+        int read() override;
+        int peek() override;
+        size_t write(uint8_t b) override;
+        void flush() override;
+        using Print::write;
+
+        void setEnabled(bool enabled);
+        void clear();
+
+        /**
+         * Print the recorded packets, oldest first, followed by the
+         * per-command latency summary.
+         * @param out Serial or the server client.
+        */
+        void dump(Print &out);
+        void dumpSummary(Print &out);
+
+        const TraceRecord *last() const;
+
+    private:
+        void onCommand(uint8_t command, unsigned long start_us);
+        void onReply(uint8_t reply, unsigned long now);
+        void commit(uint32_t duration_us);
+        TraceSummary *summaryFor(uint8_t command);
+
+        Stream &inner;
+        bool enabled = true;
+
+        PacketParser tx_parser;
+        PacketParser rx_parser;
+
+        bool pending = false;
+        bool trailing = false;  // the last record still takes data packets
+        bool tx_started = false;
+        unsigned long tx_start_us = 0;
+        uint16_t tx_count = 0;
+        unsigned long cmd_start_us = 0;
+        TraceRecord current;
+
+        TraceRecord ring[TRACE_RING_SIZE];
+        uint8_t ring_head = 0;
+        uint8_t ring_count = 0;
+
+        TraceSummary summary[TRACE_SUMMARY_SIZE];
+        uint8_t summary_count = 0;
+};
+
+
+const char *traceCommandName(uint8_t command);
+
+#endif
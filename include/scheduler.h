@@ -0,0 +1,123 @@
+/**
+ * Cooperative Task Scheduler.
+ *
+ * The loop's periodic work (heartbeat, server commands, sensor polling,
+ * display) is registered as tasks with a period and a deadline. Due
+ * times are kept in a small binary min-heap; runDue() pops every task
+ * that is due, runs it to completion and schedules its next period.
+ * Nothing is preempted, a task that runs long only makes the others late,
+ * which is what the per-task lateness and run time figures show.
+ *
+ * A task with period 0 runs on every pass. With a profiler attached,
+ * task i is recorded as profiler section i + 1. With a watchdog attached,
+ * a task with a budget runs under a watch of its own name, and one that
+ * ran over it in enough consecutive runs gets its recovery called once it
+ * has returned.
+ *
+ * A task may postpone or wake another one, or itself, while runDue() is
+ * working through its due tasks. Those already taken out of the heap only
+ * get their due time changed and go back in once, when the pass is done
+ * with them.
+*/
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "Arduino.h"
+#include "loop_profiler.h"
+#include "soft_watchdog.h"
+
+#define SCHED_MAX_TASKS 10    // profiler sections 1..10
+#define SCHED_NO_TASK -1
+
+typedef void (*TaskFunction)();
+
+
+struct TaskStats {
+    uint32_t runs;
+    uint32_t missed;            // started later than the deadline
+    unsigned long total_us;
+    unsigned long max_us;
+    unsigned long max_late;     // ms after the due time
+    uint32_t overruns;          // runs over the watchdog budget
+};
+
+
+struct Task {
+    const char *name;
+    TaskFunction run;
+    unsigned long period;       // ms
+    unsigned long deadline;     // ms of lateness allowed
+    unsigned long budget;       // ms a run may take, 0 for no watch
+    TaskFunction recover;       // after runs over budget, may be null
+    uint8_t recover_after;      // consecutive overruns before recover
+    uint8_t overrun_streak;
+    unsigned long due;
+    bool in_flight;             // taken out of the heap by runDue()
+    bool moved;                 // rescheduled while in flight
+    TaskStats stats;
+};
+
+
+class Scheduler {
+    public:
+        /**
+         * Register a task, first due at now + period.
+         * @param budget ms one run may take before the watchdog logs it.
+         * @return the task id, or SCHED_NO_TASK when full.
+        */
+        int add(const char *name, TaskFunction run, unsigned long period, unsigned long deadline, unsigned long now,
+                unsigned long budget = 0);
+
+        /**
+         * Run every task due at `now` once, earliest due first.
+        */
+        void runDue(unsigned long now);
+
+        /**
+         * Restart a task's period from `now`, e.g. the heartbeat after
+         * other traffic from the server.
+        */
+        void postpone(int id, unsigned long now);
+
+        /**
+         * Make a task due at `now`, e.g. the sensor poll after a touch.
+        */
+        void runNow(int id, unsigned long now);
+
+        /**
+         * Change a task's period, taking effect after its next run.
+        */
+        void setPeriod(int id, unsigned long period);
+
+        /**
+         * Call `recover` once `after` runs in a row went over the task's
+         * budget, e.g. to reset the hardware it was waiting on.
+        */
+        void setRecovery(int id, TaskFunction recover, uint8_t after = 1);
+
+        /**
+         * Also record each run's time in `profiler`.
+        */
+        void setProfiler(LoopProfiler *profiler);
+
+        void setWatchdog(SoftWatchdog *watchdog) { this->watchdog = watchdog; }
+
+        void resetStats();
+        void printStats(Print &out);
+
+    private:
+        void push(uint8_t id);
+        uint8_t pop();
+        bool earlier(uint8_t a, uint8_t b) const;
+        void reschedule(int id, unsigned long due);
+
+        Task tasks[SCHED_MAX_TASKS];
+        uint8_t count = 0;
+        uint8_t heap[SCHED_MAX_TASKS];
+        uint8_t heap_size = 0;
+        LoopProfiler *profiler = nullptr;
+        SoftWatchdog *watchdog = nullptr;
+};
+
+#endif
@@ -0,0 +1,78 @@
+/**
+ * Screen Manager.
+ *
+ * Keeps a small stack of timed overlay screens on top of the idle scan
+ * animation. A caller pushes a screen with a dwell time and a priority
+ * and returns right away; update(), called from loop(), draws the top
+ * screen and pops it once its dwell has run out. The dwell starts when
+ * the screen first becomes visible, so pushing B and then A shows A and
+ * then B.
+ *
+ * A screen is placed above every screen of lower or equal priority,
+ * preempt() drops the screens a new event makes obsolete, e.g. a new
+ * scan removing the previous attendee's welcome.
+*/
+
+#ifndef SCREEN_MANAGER_H
+#define SCREEN_MANAGER_H
+
+#include "Arduino.h"
+#include "lcd_buffer.h"
+#include "screen_text.h"
+
+#define SCREEN_STACK_SIZE 6
+
+enum ScreenPriority {
+    SCREEN_INFO = 0,    // scan results, welcome
+    SCREEN_RESULT = 1,  // enroll/delete outcomes
+    SCREEN_ALERT = 2    // connection problems
+};
+
+
+struct Overlay {
+    char lines[LCD_ROWS][LCD_COLS + 1];
+    unsigned long dwell;
+    unsigned long shown_at;
+    uint8_t priority;
+    bool visible;
+};
+
+
+class ScreenManager {
+    public:
+        explicit ScreenManager(LcdBuffer &screen);
+
+        /**
+         * Queue an overlay screen.
+         * @param dwell how long it stays up once visible, in ms.
+         * @return false if the stack is full and the screen was dropped.
+        */
+        bool push(const char *firstLine, const char *secondLine, unsigned long dwell, uint8_t priority);
+
+        /**
+         * Queue one of the canned screens from flash.
+         * @param secondLine RAM text replacing the screen's second line,
+         * e.g. the attendee name under "Welcome:".
+        */
+        bool push(ScreenText text, unsigned long dwell, uint8_t priority, const char *secondLine = nullptr);
+
+        /**
+         * Drop every overlay with a priority up to `priority`.
+        */
+        void preempt(uint8_t priority);
+
+        /**
+         * Expire and draw overlays.
+         * @return true while an overlay owns the display.
+        */
+        bool update(unsigned long now);
+
+        bool active() const { return depth > 0; }
+
+    private:
+        LcdBuffer &screen;
+        Overlay stack[SCREEN_STACK_SIZE];
+        uint8_t depth = 0;
+};
+
+#endif
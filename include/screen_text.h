@@ -0,0 +1,64 @@
+/**
+ * Screen Texts.
+ *
+ * Every canned screen the client shows, two lines of text kept in flash
+ * and picked by id. Drawing one of these never builds a String, so the
+ * idle animation and the result screens do not touch the heap.
+ *
+ * Lines are PROGMEM pointers: print them with FPSTR() or copy them to
+ * RAM with copyScreenLine().
+*/
+
+#ifndef SCREEN_TEXT_H
+#define SCREEN_TEXT_H
+
+#include "Arduino.h"
+
+enum ScreenText : uint8_t {
+    TEXT_CLIENT_START,
+    TEXT_CONN_WIFI,
+    TEXT_CONN_WIFI_OK,
+    TEXT_CONN_SERVER,
+    TEXT_CONN_SERVER_OK,
+    TEXT_DISCONNECTED,
+    TEXT_SCAN,
+    TEXT_ENROLL_SCAN,
+    TEXT_LCD_BENCH,
+    TEXT_IMAGE_TAKEN,
+    TEXT_PROCESSING,
+    TEXT_REMOVE_FINGER,
+    TEXT_PLACE_AGAIN,
+    TEXT_PRINTS_MATCHED,
+    TEXT_COMM_ERROR,
+    TEXT_PRINTS_MISMATCH,
+    TEXT_UNKNOWN_ERROR,
+    TEXT_SENDING_DATA,
+    TEXT_FOUND,
+    TEXT_NOT_FOUND,
+    TEXT_ENROLL_MODE,
+    TEXT_ENROLL_WAIT,
+    TEXT_ENROLL_FAIL,
+    TEXT_ENROLL_OK,
+    TEXT_WELCOME,
+    TEXT_LOGGED,
+    TEXT_LOG_FAILED,
+    TEXT_DELETE_FAIL,
+    TEXT_DELETE_OK,
+    TEXT_ALL_DELETED,
+    TEXT_REBOOTING,
+    TEXT_READY,
+    TEXT_COUNT
+};
+
+
+/**
+ * @return the PROGMEM string for one row of a screen.
+*/
+const char *screenLine(ScreenText text, uint8_t row);
+
+/**
+ * Copy one row of a screen to RAM, `dest` holds at least size bytes.
+*/
+void copyScreenLine(char *dest, size_t size, ScreenText text, uint8_t row);
+
+#endif
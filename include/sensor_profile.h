@@ -0,0 +1,69 @@
+/**
+ * Fingerprint Scanner Profile.
+ *
+ * The system parameters of the scanner (capacity, security level, packet
+ * size, baud rate, address) are read once and kept in the emulated
+ * EEPROM together with a CRC. Later boots trust the stored profile and
+ * only probe the scanner again when the profile is missing, corrupted or
+ * the scanner stops answering.
+*/
+
+#ifndef SENSOR_PROFILE_H
+#define SENSOR_PROFILE_H
+
+#include "Arduino.h"
+#include "Adafruit_Fingerprint.h"
+
+#define SENSOR_PROFILE_ADDR 0
+#define SENSOR_PROFILE_MAGIC 0x5046 // "FP"
+#define SENSOR_PROFILE_VERSION 1
+#define EEPROM_SIZE 64
+
+
+struct SensorProfile {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t reserved;
+    uint16_t system_id;
+    uint16_t capacity;
+    uint16_t security_level;
+    uint16_t packet_len;
+    uint32_t device_addr;
+    uint32_t baud_rate;
+    uint16_t checksum;
+};
+
+
+/**
+ * Load the profile from flash.
+ * @return false if nothing valid is stored, profile is left as it was.
+*/
+bool loadSensorProfile(SensorProfile &profile);
+
+void saveSensorProfile(SensorProfile &profile);
+
+void clearSensorProfile();
+
+/**
+ * Read the system parameters from the scanner into a profile.
+ * @return false if the scanner did not answer.
+*/
+bool probeSensorProfile(Adafruit_Fingerprint &scanner, SensorProfile &profile);
+
+/**
+ * Fill a profile from the library's own parameters, its defaults until
+ * getParameters() has succeeded. Used when nothing better is known.
+*/
+void defaultSensorProfile(Adafruit_Fingerprint &scanner, SensorProfile &profile);
+
+/**
+ * Hand a stored profile to the library, in place of getParameters().
+ * fingerSearch() sends the library's capacity as its search range.
+*/
+void applySensorProfile(const SensorProfile &profile, Adafruit_Fingerprint &scanner);
+
+bool sensorProfileMatches(const SensorProfile &a, const SensorProfile &b);
+
+void printSensorProfile(Print &out, const SensorProfile &profile);
+
+#endif
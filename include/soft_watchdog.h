@@ -0,0 +1,108 @@
+/**
+ * Software Watchdog.
+ *
+ * Long operations and scheduler tasks run under a named watch with a
+ * time budget. Watches nest: begin() pushes one, end() pops it. A loop
+ * that waits on hardware polls expired(), which yields to the system so
+ * the hardware watchdog stays fed, and gets true once the budget is spent
+ * so it can recover or give up. Every overrun is logged with the
+ * operation's name.
+ *
+ * Scheduler tasks cannot be stopped while they run. The scheduler reads
+ * end() and calls the task's recovery, see Scheduler::setRecovery(). A
+ * task that never returns still ends in the system watchdog.
+ *
+ * The innermost watch is mirrored to RTC memory, which survives a reset.
+ * This happens when a wait is found over budget and from the core's crash
+ * callback, which runs for exceptions and the system watchdog. Watches
+ * that end in time never touch RTC memory. The next boot can tell which
+ * operation was running, see reportReset(). A hardware watchdog reset
+ * skips the callback and only shows a wait that had run over.
+*/
+
+#ifndef SOFT_WATCHDOG_H
+#define SOFT_WATCHDOG_H
+
+#include "Arduino.h"
+
+#define WATCHDOG_DEPTH 4
+#define WATCHDOG_LOG 8
+#define WATCHDOG_NAME 12
+#define WATCHDOG_RTC_OFFSET 32  // RTC user memory block in 4 byte units, clear of the OTA boot command
+#define WATCHDOG_RTC_MAGIC 0x57444F47
+
+
+struct Overrun {
+    char name[WATCHDOG_NAME];
+    unsigned long budget;
+    unsigned long elapsed;
+    unsigned long at;   // millis() when it was noticed
+};
+
+
+struct Watch {
+    const char *name;
+    unsigned long started;
+    unsigned long budget;
+    bool reported;
+};
+
+
+class SoftWatchdog {
+    public:
+        /**
+         * Start watching an operation, budget in ms.
+        */
+        void begin(const char *name, unsigned long budget);
+
+        /**
+         * Yield, then check the innermost watch.
+         * @return true once its budget is spent, the overrun is logged
+         * the first time.
+        */
+        bool expired();
+
+        /**
+         * Stop the innermost watch, logging it if it ran over.
+         * @return true if it ran over its budget.
+        */
+        bool end();
+
+        /**
+         * Log an overrun timed by the caller, for operations that span
+         * several loop passes and so cannot hold a watch.
+        */
+        void overrun(const char *name, unsigned long budget, unsigned long elapsed);
+
+        /**
+         * After a watchdog or exception reset, print the operation that
+         * was running when it happened.
+        */
+        void reportReset(Print &out);
+
+        void printStats(Print &out);
+        void resetStats();
+
+        /**
+         * Write the innermost watch to RTC memory, empty when idle.
+        */
+        void mirror();
+
+        uint32_t overruns = 0;
+
+    private:
+        void log(const Watch &watch, unsigned long elapsed);
+        void readReset();
+
+        Watch watches[WATCHDOG_DEPTH];
+        uint8_t depth = 0;
+        uint8_t skipped = 0;    // begin() calls beyond WATCHDOG_DEPTH
+        Overrun history[WATCHDOG_LOG];
+        uint8_t history_head = 0;
+        uint8_t history_count = 0;
+        char reset_name[WATCHDOG_NAME];     // running when the last boot ended
+        bool reset_known = false;
+        bool reset_read = false;
+};
+
+#endif
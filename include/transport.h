@@ -0,0 +1,181 @@
+/**
+ * Server Link Transports.
+ *
+ * The firmware talks to the server through a Transport, a Stream with a
+ * connect/stop pair. Two implementations, picked at build time:
+ *
+ *  WiFiTransport   the polled WiFiClient, reads go straight to lwIP's
+ *                  buffers (default).
+ *  AsyncTransport  ESPAsyncTCP callbacks, built with -D TRANSPORT_ASYNC.
+ *                  Received bytes are queued in a ring by the data
+ *                  callback, writes are queued and handed to TCP as
+ *                  send window frees up, on ACK and on poll.
+ *
+ * ESPAsyncTCP callbacks run from the system context while the sketch
+ * yields, never in the middle of loop() code, so the rings need no locks.
+ *
+ * rxStamp() is the micros() time the next unread byte arrived. Each
+ * batch of bytes a transport learns about gets its own stamp, so a line
+ * queued behind another keeps its own arrival time; the difference to the
+ * moment the dispatcher picks the line up is the command latency. The
+ * polled transport learns about bytes in available(), the asynchronous
+ * one in its data callback.
+*/
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include "Arduino.h"
+#include "WiFiClient.h"
+#ifdef TRANSPORT_ASYNC
+#include "ESPAsyncTCP.h"
+#endif
+
+#define TRANSPORT_RX_SIZE 1024
+#define TRANSPORT_TX_SIZE 1024
+#define TRANSPORT_FLUSH_TIMEOUT 200 // ms flush() waits for the send queue
+#define TRANSPORT_STAMPS 8          // arrival batches timed separately
+
+
+struct TransportStats {
+    uint32_t rx_bytes;
+    uint32_t tx_bytes;
+    uint32_t rx_dropped;    // receive queue full
+    uint32_t tx_dropped;    // send queue full
+    uint16_t rx_peak;       // most bytes queued
+    uint16_t tx_peak;
+};
+
+
+class Transport : public Stream {
+    public:
+        /**
+         * Connect, or for an asynchronous transport start connecting.
+         * @return true once connected, call again until then.
+        */
+        virtual bool connect(const char *host, uint16_t port) = 0;
+        virtual bool connected() = 0;
+        virtual void stop() = 0;
+        virtual const char *name() const = 0;
+
+        /**
+         * @return micros() when the next unread byte arrived, 0 if none.
+        */
+        unsigned long rxStamp() const { return stamp_count ? stamps[stamp_head].at : 0; }
+
+        void resetStats();
+        void printStats(Print &out);
+
+        TransportStats stats;
+
+    protected:
+        /**
+         * `len` bytes arrived after those already stamped. With every
+         * stamp in use they join the newest batch and its older time.
+        */
+        void stampArrived(size_t len);
+
+        /**
+         * One byte was read, the oldest batch shrinks.
+        */
+        void stampRead();
+
+        void clearStamps();
+
+        size_t stamped = 0;     // unread bytes covered by stamps
+
+    private:
+        struct RxBatch {
+            unsigned long at;
+            size_t bytes;
+        };
+
+        RxBatch stamps[TRANSPORT_STAMPS];
+        uint8_t stamp_head = 0;
+        uint8_t stamp_count = 0;
+};
+
+
+class WiFiTransport : public Transport {
+    public:
+        bool connect(const char *host, uint16_t port) override;
+        bool connected() override;
+        void stop() override;
+        const char *name() const override { return "wifiClient"; }
+
+        int available() override;
+        int read() override;
+        int peek() override;
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t *buffer, size_t size) override;
+        int availableForWrite() override;
+        void flush() override;
+
+    private:
+        WiFiClient tcp;
+};
+
+
+#ifdef TRANSPORT_ASYNC
+
+/**
+ * Byte ring shared by both directions of AsyncTransport.
+*/
+template <size_t SIZE>
+struct ByteRing {
+    uint8_t data[SIZE];
+    size_t head = 0;
+    size_t count = 0;
+
+    size_t push(const uint8_t *src, size_t len) {
+        size_t n = 0;
+        while (n < len && count < SIZE) {
+            data[(head + count) % SIZE] = src[n++];
+            count++;
+        }
+        return n;
+    }
+
+    // contiguous bytes from head
+    size_t span() const {
+        return count < SIZE - head ? count : SIZE - head;
+    }
+
+    void drop(size_t len) {
+        head = (head + len) % SIZE;
+        count -= len;
+    }
+};
+
+
+class AsyncTransport : public Transport {
+    public:
+        AsyncTransport();
+
+        bool connect(const char *host, uint16_t port) override;
+        bool connected() override;
+        void stop() override;
+        const char *name() const override { return "asyncTcp"; }
+
+        int available() override;
+        int read() override;
+        int peek() override;
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t *buffer, size_t size) override;
+        int availableForWrite() override;
+        void flush() override;
+
+    private:
+        void receive(const uint8_t *data, size_t len);
+        void drain();
+
+        AsyncClient tcp;
+        ByteRing<TRANSPORT_RX_SIZE> rx;
+        ByteRing<TRANSPORT_TX_SIZE> tx;
+        bool connecting = false;
+        bool is_connected = false;
+};
+
+#endif
+
+#endif
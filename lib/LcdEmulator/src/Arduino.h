@@ -0,0 +1,100 @@
+/**
+ * Minimal Arduino core for the host build.
+ *
+ * Just enough of the ESP8266 Arduino API for the display code in src/
+ * (lcd_i2c, lcd_buffer, screen_manager, screen_text) and for the
+ * Adafruit_Fingerprint library driving the sensor emulator to compile
+ * and run natively. Flash and RAM are the same memory here, the PROGMEM helpers
+ * read directly.
+ * Time is virtual and only moves when delay() or hostAdvance() is called.
+*/
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x00
+#define OUTPUT 0x01
+#define INPUT_PULLUP 0x02
+
+#define DEC 10
+#define HEX 16
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_ptr(p) (*(void *const *)(p))
+#define strncpy_P strncpy
+#define strlen_P strlen
+
+class __FlashStringHelper;
+#define FPSTR(p) ((const __FlashStringHelper *)(p))
+#define F(s) FPSTR(s)
+
+
+class Print {
+    public:
+        virtual ~Print() {}
+        virtual size_t write(uint8_t c) = 0;
+        virtual size_t write(const uint8_t *buffer, size_t size);
+        virtual void flush() {}
+
+        size_t write(const char *str) { return str ? write((const uint8_t *)str, strlen(str)) : 0; }
+
+        size_t print(const char *str) { return write(str); }
+        size_t print(const __FlashStringHelper *str) { return write((const char *)str); }
+        size_t print(char c) { return write((uint8_t)c); }
+        size_t print(unsigned char n, int base = DEC) { return print((unsigned long)n, base); }
+        size_t print(int n, int base = DEC) { return print((long)n, base); }
+        size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+        size_t print(long n, int base = DEC);
+        size_t print(unsigned long n, int base = DEC);
+
+        size_t println() { return write('\n'); }
+        template <typename T> size_t println(T value) { size_t n = print(value); return n + println(); }
+};
+
+
+class Stream : public Print {
+    public:
+        virtual int available() = 0;
+        virtual int read() = 0;
+        virtual int peek() = 0;
+};
+
+
+/**
+ * Only named by the Adafruit_Fingerprint constructors, nothing on the
+ * host is a hardware UART.
+*/
+class HardwareSerial : public Stream {
+    public:
+        virtual void begin(unsigned long baud) { (void)baud; }
+};
+
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+
+/**
+ * Move the virtual clock forward without going through delay().
+*/
+void hostAdvance(unsigned long us);
+
+#endif
@@ -0,0 +1,42 @@
+/**
+ * Host EEPROM shim. The emulated flash sector is a RAM array that keeps
+ * its contents across begin()/end(), like the real one does across
+ * boots, and starts out erased.
+*/
+
+#ifndef HOST_EEPROM_H
+#define HOST_EEPROM_H
+
+#include "Arduino.h"
+
+#define HOST_EEPROM_SIZE 4096
+
+
+class EEPROMClass {
+    public:
+        EEPROMClass() { memset(data, 0xFF, sizeof(data)); }
+
+        void begin(size_t size) { (void)size; }
+        bool commit() { return true; }
+        void end() {}
+
+        uint8_t read(int address) const { return data[address]; }
+        void write(int address, uint8_t value) { data[address] = value; }
+
+        template <typename T> T &get(int address, T &t) const {
+            memcpy(&t, data + address, sizeof(T));
+            return t;
+        }
+
+        template <typename T> const T &put(int address, const T &t) {
+            memcpy(data + address, &t, sizeof(T));
+            return t;
+        }
+
+    private:
+        uint8_t data[HOST_EEPROM_SIZE];
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
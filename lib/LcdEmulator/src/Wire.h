@@ -0,0 +1,26 @@
+/**
+ * Host Wire shim. Every transmission is handed to lcdEmulator().
+*/
+
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include "Arduino.h"
+
+#define BUFFER_LENGTH 128
+#define SDA 4
+#define SCL 5
+
+
+class TwoWire {
+    public:
+        void begin() {}
+        void setClock(uint32_t clock) { (void)clock; }
+        void beginTransmission(uint8_t address);
+        size_t write(uint8_t data);
+        uint8_t endTransmission(bool stop = true);
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,165 @@
+#include "lcd_emulator.h"
+#include <string.h>
+
+#define EXP_RS 0x01
+#define EXP_EN 0x04
+#define EXP_BACKLIGHT 0x08
+
+
+Hd44780Emulator::Hd44780Emulator() {
+    reset();
+}
+
+
+void Hd44780Emulator::reset() {
+    // DDRAM holds garbage at power on, spaces keep snapshots readable.
+    memset(ddram_mem, ' ', sizeof(ddram_mem));
+    memset(cgram_mem, 0, sizeof(cgram_mem));
+    ac = 0;
+    cgram_mode = false;
+    increment = true;
+    display_on = false;
+    backlight = false;
+    four_bit = false;
+    two_lines = false;
+    shift = 0;
+    last = 0;
+    have_high = false;
+    counters = BusCounters();
+}
+
+
+void Hd44780Emulator::beginTransmission() {
+    counters.transmissions++;
+    counters.bytes++;
+}
+
+
+void Hd44780Emulator::feed(uint8_t expander) {
+    counters.bytes++;
+    backlight = expander & EXP_BACKLIGHT;
+
+    if ((last & EXP_EN) && !(expander & EXP_EN)) {
+        strobe(last >> 4, last & EXP_RS);
+    }
+    last = expander;
+}
+
+
+void Hd44780Emulator::strobe(uint8_t nibble, bool rs) {
+    if (!four_bit) {
+        // 8-bit interface, D0..D3 are not wired and read as zero.
+        execute(nibble << 4, rs);
+        return;
+    }
+
+    if (!have_high) {
+        high_nibble = nibble;
+        have_high = true;
+        return;
+    }
+    have_high = false;
+    execute((high_nibble << 4) | nibble, rs);
+}
+
+
+void Hd44780Emulator::execute(uint8_t value, bool rs) {
+    if (rs) {
+        counters.data_writes++;
+        if (cgram_mode) {
+            cgram_mem[ac & 0x3F] = value & 0x1F;
+            ac = (ac + (increment ? 1 : -1)) & 0x3F;
+        }
+        else {
+            ddram_mem[ac & 0x7F] = value;
+            ac = (ac + (increment ? 1 : -1)) & 0x7F;
+        }
+        return;
+    }
+
+    counters.instructions++;
+    if (value & 0x80) {
+        cgram_mode = false;
+        ac = value & 0x7F;
+    }
+    else if (value & 0x40) {
+        cgram_mode = true;
+        ac = value & 0x3F;
+    }
+    else if (value & 0x20) {
+        four_bit = !(value & 0x10);
+        two_lines = value & 0x08;
+        have_high = false;
+    }
+    else if (value & 0x10) {
+        // cursor or display shift, only display shift changes the view.
+        if (value & 0x08) {
+            shift = (value & 0x04) ? shift + 1 : shift - 1;
+        }
+    }
+    else if (value & 0x08) {
+        display_on = value & 0x04;
+    }
+    else if (value & 0x04) {
+        increment = value & 0x02;
+    }
+    else if (value & 0x02) {
+        cgram_mode = false;
+        ac = 0;
+        shift = 0;
+    }
+    else if (value & 0x01) {
+        memset(ddram_mem, ' ', sizeof(ddram_mem));
+        cgram_mode = false;
+        ac = 0;
+        shift = 0;
+        increment = true;
+    }
+}
+
+
+uint8_t Hd44780Emulator::visibleAddress(uint8_t r, uint8_t c) const {
+    uint8_t base = r == 0 ? 0x00 : 0x40;
+    return base + (uint8_t)((c + shift) % 40);
+}
+
+
+std::string Hd44780Emulator::row(uint8_t r) const {
+    std::string text;
+    for (uint8_t c = 0; c < EMU_LCD_COLS; c++) {
+        uint8_t ch = ddram_mem[visibleAddress(r, c)];
+        if (ch < 8) {
+            text += '*';
+        }
+        else if (ch == 0xFF) {
+            text += '#';
+        }
+        else {
+            text += (char)ch;
+        }
+    }
+    return text;
+}
+
+
+std::string Hd44780Emulator::glyphRow(uint8_t r) const {
+    std::string marks;
+    bool any = false;
+    for (uint8_t c = 0; c < EMU_LCD_COLS; c++) {
+        uint8_t ch = ddram_mem[visibleAddress(r, c)];
+        if (ch < 8) {
+            marks += (char)('0' + ch);
+            any = true;
+        }
+        else {
+            marks += ' ';
+        }
+    }
+    return any ? marks : std::string();
+}
+
+
+Hd44780Emulator &lcdEmulator() {
+    static Hd44780Emulator emulator;
+    return emulator;
+}
@@ -0,0 +1,93 @@
+/**
+ * HD44780 + PCF8574 Liquid Crystal Display Emulator.
+ *
+ * Decodes the byte stream written to the I2C backpack back into HD44780
+ * state: DDRAM, CGRAM, address counter, entry mode and display control.
+ * Bytes are fed exactly as the backend puts them on the bus, so the
+ * firmware's LcdI2C, LcdBuffer and ScreenManager can run unchanged on the
+ * host against the Wire shim in this library.
+ *
+ * Expander bits follow the backpack wiring:
+ *  P0 RS, P1 RW, P2 EN, P3 backlight, P4..P7 D4..D7
+ * The controller latches D4..D7 on the falling edge of EN.
+*/
+
+#ifndef LCD_EMULATOR_H
+#define LCD_EMULATOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+#define EMU_LCD_COLS 16
+#define EMU_LCD_ROWS 2
+
+
+struct BusCounters {
+    uint32_t transmissions = 0;
+    uint32_t bytes = 0;         // address bytes included
+    uint32_t instructions = 0;  // decoded HD44780 instructions
+    uint32_t data_writes = 0;   // decoded DDRAM/CGRAM writes
+};
+
+
+class Hd44780Emulator {
+    public:
+        Hd44780Emulator();
+
+        void reset();
+
+        // one I2C transmission to the backpack
+        void beginTransmission();
+        void feed(uint8_t expander);
+
+        /**
+         * Visible text, one string per row. Characters 0..7 are CGRAM
+         * glyphs and are shown as '*', see glyphRow(). The ROM full
+         * block 0xFF is shown as '#'.
+        */
+        std::string row(uint8_t r) const;
+
+        /**
+         * Marker line for row(r): the CGRAM slot digit under each glyph
+         * cell, a space elsewhere. Empty if the row has no glyphs.
+        */
+        std::string glyphRow(uint8_t r) const;
+
+        uint8_t ddram(uint8_t address) const { return ddram_mem[address & 0x7F]; }
+        uint8_t cgram(uint8_t address) const { return cgram_mem[address & 0x3F]; }
+        uint8_t cursor() const { return ac; }
+        bool displayOn() const { return display_on; }
+        bool backlightOn() const { return backlight; }
+        bool fourBitMode() const { return four_bit; }
+
+        BusCounters counters;
+
+    private:
+        void strobe(uint8_t nibble, bool rs);
+        void execute(uint8_t value, bool rs);
+        uint8_t visibleAddress(uint8_t r, uint8_t c) const;
+
+        uint8_t ddram_mem[128];
+        uint8_t cgram_mem[64];
+        uint8_t ac = 0;
+        bool cgram_mode = false;
+        bool increment = true;
+        bool display_on = false;
+        bool backlight = false;
+        bool four_bit = false;
+        bool two_lines = false;
+        uint8_t shift = 0;
+
+        uint8_t last = 0;
+        bool have_high = false;
+        uint8_t high_nibble = 0;
+};
+
+
+/**
+ * The emulator the host Wire shim delivers transmissions to.
+*/
+Hd44780Emulator &lcdEmulator();
+
+#endif
@@ -0,0 +1,308 @@
+#include "sensor_emulator.h"
+
+
+SensorEmulator::SensorEmulator(const SensorConfig &config) :
+    cfg(config),
+    library(config.capacity, EMU_NO_FINGER)
+{
+    // 8N1 framing, 10 bits on the wire per byte.
+    byte_us = (10UL * 1000000UL + cfg.baud - 1) / cfg.baud;
+}
+
+
+void SensorEmulator::advance(uint64_t us) {
+    clock_us += us;
+    applyEvents();
+}
+
+
+void SensorEmulator::busy(uint32_t us) {
+    stats.busy_us += us;
+    advance(us);
+}
+
+
+void SensorEmulator::applyEvents() {
+    while (!events.empty() && events.front().at_us <= clock_us) {
+        finger_on = events.front().finger;
+        finger_messy = events.front().messy;
+        events.pop_front();
+    }
+}
+
+
+void SensorEmulator::scheduleFinger(uint64_t at_us, int finger, bool messy) {
+    FingerEvent e = { at_us, finger, messy };
+
+    auto it = events.begin();
+    while (it != events.end() && it->at_us <= at_us) {
+        ++it;
+    }
+    events.insert(it, e);
+    applyEvents();
+}
+
+
+void SensorEmulator::placeFinger(int finger, bool messy) {
+    finger_on = finger;
+    finger_messy = messy;
+}
+
+
+void SensorEmulator::liftFinger() {
+    finger_on = EMU_NO_FINGER;
+    finger_messy = false;
+}
+
+
+bool SensorEmulator::storeTemplate(uint16_t id, int finger) {
+    if (id >= library.size()) {
+        return false;
+    }
+    library[id] = finger;
+    return true;
+}
+
+
+int SensorEmulator::templateAt(uint16_t id) const {
+    return id < library.size() ? library[id] : EMU_NO_FINGER;
+}
+
+
+uint16_t SensorEmulator::templateCount() const {
+    uint16_t count = 0;
+    for (int finger : library) {
+        if (finger != EMU_NO_FINGER) {
+            count++;
+        }
+    }
+    return count;
+}
+
+
+int SensorEmulator::available() const {
+    return (int)tx_queue.size();
+}
+
+
+int SensorEmulator::peek() const {
+    return tx_queue.empty() ? -1 : tx_queue.front();
+}
+
+
+int SensorEmulator::read() {
+    if (tx_queue.empty()) {
+        return -1;
+    }
+    uint8_t b = tx_queue.front();
+    tx_queue.pop_front();
+    stats.rx_bytes++;
+    advance(byte_us);
+    return b;
+}
+
+
+void SensorEmulator::write(uint8_t b) {
+    stats.tx_bytes++;
+    advance(byte_us);
+
+    size_t index = rx_packet.size();
+    if ((index == 0 && b != (FINGERPRINT_STARTCODE >> 8)) ||
+        (index == 1 && b != (FINGERPRINT_STARTCODE & 0xFF))) {
+        rx_packet.clear();
+        return;
+    }
+    rx_packet.push_back(b);
+
+    if (rx_packet.size() < 9) {
+        return;
+    }
+    size_t length = ((size_t)rx_packet[7] << 8) | rx_packet[8];
+    if (rx_packet.size() < 9 + length) {
+        return;
+    }
+
+    stats.packets++;
+    uint16_t sum = 0;
+    for (size_t i = 6; i < 7 + length; i++) {
+        sum += rx_packet[i];
+    }
+    uint16_t expected = ((uint16_t)rx_packet[7 + length] << 8) | rx_packet[8 + length];
+
+    if (length < 3 || sum != expected || rx_packet[6] != FINGERPRINT_COMMANDPACKET) {
+        stats.bad_packets++;
+        rx_packet.clear();
+        reply(FINGERPRINT_PACKETRECIEVEERR);
+        return;
+    }
+
+    std::vector<uint8_t> payload(rx_packet.begin() + 9, rx_packet.begin() + 7 + length);
+    rx_packet.clear();
+    execute(payload);
+}
+
+
+void SensorEmulator::reply(uint8_t code, const uint8_t *data, size_t len) {
+    uint16_t length = (uint16_t)(len + 3);
+    uint8_t header[9] = {
+        FINGERPRINT_STARTCODE >> 8, FINGERPRINT_STARTCODE & 0xFF,
+        (uint8_t)(cfg.address >> 24), (uint8_t)(cfg.address >> 16),
+        (uint8_t)(cfg.address >> 8), (uint8_t)cfg.address,
+        FINGERPRINT_ACKPACKET, (uint8_t)(length >> 8), (uint8_t)length
+    };
+    tx_queue.insert(tx_queue.end(), header, header + 9);
+
+    uint16_t sum = FINGERPRINT_ACKPACKET + (length >> 8) + (length & 0xFF) + code;
+    tx_queue.push_back(code);
+    for (size_t i = 0; i < len; i++) {
+        tx_queue.push_back(data[i]);
+        sum += data[i];
+    }
+    tx_queue.push_back(sum >> 8);
+    tx_queue.push_back(sum & 0xFF);
+}
+
+
+void SensorEmulator::execute(const std::vector<uint8_t> &payload) {
+    const SensorLatency &lat = cfg.latency;
+    size_t args = payload.size() - 1;
+
+    switch (payload[0]) {
+        case FINGERPRINT_HANDSHAKE:
+            busy(lat.handshake_us);
+            reply(FINGERPRINT_OK);
+            break;
+
+        case FINGERPRINT_VERIFYPASSWORD: {
+            busy(lat.handshake_us);
+            uint32_t password = 0;
+            for (size_t i = 1; i < payload.size() && i <= 4; i++) {
+                password = (password << 8) | payload[i];
+            }
+            reply(password == cfg.password ? FINGERPRINT_OK : FINGERPRINT_PASSFAIL);
+            break;
+        }
+
+        case FINGERPRINT_GETIMAGE:
+            busy(lat.get_image_us);
+            image = finger_on;
+            image_messy = finger_messy;
+            reply(image != EMU_NO_FINGER ? FINGERPRINT_OK : FINGERPRINT_NOFINGER);
+            break;
+
+        case FINGERPRINT_IMAGE2TZ: {
+            busy(lat.image2tz_us);
+            uint8_t slot = args >= 1 ? payload[1] : 1;
+            if (slot < 1 || slot > 2 || image == EMU_NO_FINGER) {
+                reply(FINGERPRINT_INVALIDIMAGE);
+            }
+            else if (image_messy) {
+                reply(FINGERPRINT_IMAGEMESS);
+            }
+            else {
+                char_buffer[slot - 1] = image;
+                reply(FINGERPRINT_OK);
+            }
+            break;
+        }
+
+        case FINGERPRINT_REGMODEL:
+            busy(lat.create_model_us);
+            if (char_buffer[0] != EMU_NO_FINGER && char_buffer[0] == char_buffer[1]) {
+                model = char_buffer[0];
+                reply(FINGERPRINT_OK);
+            }
+            else {
+                model = EMU_NO_FINGER;
+                reply(FINGERPRINT_ENROLLMISMATCH);
+            }
+            break;
+
+        case FINGERPRINT_STORE: {
+            busy(lat.store_model_us);
+            uint16_t id = args >= 3 ? ((uint16_t)payload[2] << 8) | payload[3] : 0xFFFF;
+            if (id >= library.size()) {
+                reply(FINGERPRINT_BADLOCATION);
+            }
+            else {
+                library[id] = model;
+                reply(FINGERPRINT_OK);
+            }
+            break;
+        }
+
+        case FINGERPRINT_SEARCH: {
+            busy(lat.search_us);
+            uint8_t slot = args >= 1 ? payload[1] : 1;
+            int finger = (slot >= 1 && slot <= 2) ? char_buffer[slot - 1] : EMU_NO_FINGER;
+            uint16_t start = args >= 3 ? ((uint16_t)payload[2] << 8) | payload[3] : 0;
+            uint16_t count = args >= 5 ? ((uint16_t)payload[4] << 8) | payload[5] : library.size();
+
+            for (size_t id = start; finger != EMU_NO_FINGER && id < library.size() && id < (size_t)start + count; id++) {
+                if (library[id] == finger) {
+                    uint8_t data[4] = { (uint8_t)(id >> 8), (uint8_t)id, 0x00, 0x64 };
+                    reply(FINGERPRINT_OK, data, sizeof(data));
+                    return;
+                }
+            }
+            uint8_t none[4] = { 0, 0, 0, 0 };
+            reply(FINGERPRINT_NOTFOUND, none, sizeof(none));
+            break;
+        }
+
+        case FINGERPRINT_DELETE: {
+            busy(lat.delete_model_us);
+            uint16_t id = args >= 2 ? ((uint16_t)payload[1] << 8) | payload[2] : 0xFFFF;
+            uint16_t count = args >= 4 ? ((uint16_t)payload[3] << 8) | payload[4] : 1;
+            if (id >= library.size() || (size_t)id + count > library.size()) {
+                reply(FINGERPRINT_BADLOCATION);
+                break;
+            }
+            for (uint16_t i = 0; i < count; i++) {
+                library[id + i] = EMU_NO_FINGER;
+            }
+            reply(FINGERPRINT_OK);
+            break;
+        }
+
+        case FINGERPRINT_EMPTY:
+            busy(lat.empty_database_us);
+            for (int &finger : library) {
+                finger = EMU_NO_FINGER;
+            }
+            reply(FINGERPRINT_OK);
+            break;
+
+        case FINGERPRINT_TEMPLATECOUNT: {
+            busy(lat.misc_us);
+            uint16_t count = templateCount();
+            uint8_t data[2] = { (uint8_t)(count >> 8), (uint8_t)count };
+            reply(FINGERPRINT_OK, data, sizeof(data));
+            break;
+        }
+
+        case FINGERPRINT_READSYSPARAM: {
+            busy(lat.misc_us);
+            uint8_t size_code = cfg.packet_len >= 256 ? 3 : cfg.packet_len >= 128 ? 2 : cfg.packet_len >= 64 ? 1 : 0;
+            uint16_t baud_n = (uint16_t)(cfg.baud / 9600);
+            uint8_t data[16] = {
+                0x00, 0x00,                                         // status
+                0x00, 0x09,                                         // system id
+                (uint8_t)(cfg.capacity >> 8), (uint8_t)cfg.capacity,
+                (uint8_t)(cfg.security_level >> 8), (uint8_t)cfg.security_level,
+                (uint8_t)(cfg.address >> 24), (uint8_t)(cfg.address >> 16),
+                (uint8_t)(cfg.address >> 8), (uint8_t)cfg.address,
+                0x00, size_code,
+                (uint8_t)(baud_n >> 8), (uint8_t)baud_n
+            };
+            reply(FINGERPRINT_OK, data, sizeof(data));
+            break;
+        }
+
+        default:
+            busy(lat.misc_us);
+            reply(FINGERPRINT_PACKETRECIEVEERR);
+            break;
+    }
+}
+
@@ -0,0 +1,161 @@
+/**
+ * Fingerprint Sensor Emulator.
+ *
+ * Host side model of the optical fingerprint module wired to FINGER_RX
+ * and FINGER_TX. It speaks the same UART packet protocol as the real
+ * sensor, SensorStream (sensor_stream.h) hands it to Adafruit_Fingerprint
+ * so the library's scan and enroll commands can be benchmarked on a Linux
+ * box with the `native` PlatformIO env.
+ *
+ * Time is virtual. Every byte on the wire costs one UART frame at the
+ * configured baud rate and every command costs its configured latency,
+ * so results are deterministic and independent of the host speed.
+ *
+ * Fingers are identified by a positive integer. A template stored in the
+ * library simply remembers which finger produced it, and a search matches
+ * when the finger currently in the char buffer is the same one.
+*/
+
+#ifndef SENSOR_EMULATOR_H
+#define SENSOR_EMULATOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <deque>
+#include <vector>
+
+#define EMU_NO_FINGER 0
+
+// protocol constants, same values as Adafruit_Fingerprint.h
+#ifndef FINGERPRINT_OK
+#define FINGERPRINT_OK 0x00
+#define FINGERPRINT_PACKETRECIEVEERR 0x01
+#define FINGERPRINT_NOFINGER 0x02
+#define FINGERPRINT_IMAGEFAIL 0x03
+#define FINGERPRINT_IMAGEMESS 0x06
+#define FINGERPRINT_FEATUREFAIL 0x07
+#define FINGERPRINT_NOTFOUND 0x09
+#define FINGERPRINT_ENROLLMISMATCH 0x0A
+#define FINGERPRINT_BADLOCATION 0x0B
+#define FINGERPRINT_DELETEFAIL 0x10
+#define FINGERPRINT_PASSFAIL 0x13
+#define FINGERPRINT_INVALIDIMAGE 0x15
+#define FINGERPRINT_FLASHERR 0x18
+
+#define FINGERPRINT_STARTCODE 0xEF01
+#define FINGERPRINT_COMMANDPACKET 0x1
+#define FINGERPRINT_ACKPACKET 0x7
+
+#define FINGERPRINT_GETIMAGE 0x01
+#define FINGERPRINT_IMAGE2TZ 0x02
+#define FINGERPRINT_SEARCH 0x04
+#define FINGERPRINT_REGMODEL 0x05
+#define FINGERPRINT_STORE 0x06
+#define FINGERPRINT_DELETE 0x0C
+#define FINGERPRINT_EMPTY 0x0D
+#define FINGERPRINT_READSYSPARAM 0x0F
+#define FINGERPRINT_VERIFYPASSWORD 0x13
+#define FINGERPRINT_TEMPLATECOUNT 0x1D
+#endif
+
+#ifndef FINGERPRINT_HANDSHAKE
+#define FINGERPRINT_HANDSHAKE 0x40
+#endif
+
+
+struct SensorLatency {
+    uint32_t handshake_us = 2000;
+    uint32_t get_image_us = 90000;
+    uint32_t image2tz_us = 280000;
+    uint32_t create_model_us = 40000;
+    uint32_t store_model_us = 60000;
+    uint32_t search_us = 220000;
+    uint32_t delete_model_us = 40000;
+    uint32_t empty_database_us = 120000;
+    uint32_t misc_us = 2000;
+};
+
+
+struct SensorConfig {
+    uint32_t baud = 57600;
+    uint32_t password = 0;
+    uint32_t address = 0xFFFFFFFF;
+    uint16_t capacity = 127;
+    uint16_t security_level = 3;
+    uint16_t packet_len = 128;
+    SensorLatency latency;
+};
+
+
+/**
+ * A scripted change of what is lying on the sensor window.
+ * `finger` is EMU_NO_FINGER when the finger is lifted. A messy placement
+ * makes the next image2Tz fail with FINGERPRINT_IMAGEMESS.
+*/
+struct FingerEvent {
+    uint64_t at_us;
+    int finger;
+    bool messy;
+};
+
+
+struct SensorCounters {
+    uint32_t packets = 0;
+    uint32_t bad_packets = 0;
+    uint64_t tx_bytes = 0;      // host to sensor
+    uint64_t rx_bytes = 0;      // sensor to host
+    uint64_t busy_us = 0;       // time spent executing commands
+};
+
+
+class SensorEmulator {
+    public:
+        explicit SensorEmulator(const SensorConfig &config = SensorConfig());
+
+        // byte interface, mirrors the Stream calls the library makes.
+        void write(uint8_t b);
+        int available() const;
+        int read();
+        int peek() const;
+
+        uint64_t now() const { return clock_us; }
+        void advance(uint64_t us);
+
+        void scheduleFinger(uint64_t at_us, int finger, bool messy = false);
+        void placeFinger(int finger, bool messy = false);
+        void liftFinger();
+
+        // template library
+        bool storeTemplate(uint16_t id, int finger);
+        int templateAt(uint16_t id) const;
+        uint16_t templateCount() const;
+
+        const SensorConfig &config() const { return cfg; }
+        const SensorCounters &counters() const { return stats; }
+        uint32_t byteTime() const { return byte_us; }
+
+    private:
+        void applyEvents();
+        void execute(const std::vector<uint8_t> &payload);
+        void reply(uint8_t code, const uint8_t *data = nullptr, size_t len = 0);
+        void busy(uint32_t us);
+
+        SensorConfig cfg;
+        SensorCounters stats;
+        uint32_t byte_us;
+        uint64_t clock_us = 0;
+
+        std::vector<uint8_t> rx_packet;
+        std::deque<uint8_t> tx_queue;
+        std::deque<FingerEvent> events;
+
+        int finger_on = EMU_NO_FINGER;
+        bool finger_messy = false;
+        int image = EMU_NO_FINGER;
+        bool image_messy = false;
+        int char_buffer[2] = { EMU_NO_FINGER, EMU_NO_FINGER };
+        int model = EMU_NO_FINGER;
+        std::vector<int> library;
+};
+
+#endif
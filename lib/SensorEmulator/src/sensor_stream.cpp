@@ -0,0 +1,46 @@
+#include "sensor_stream.h"
+
+
+SensorStream::SensorStream(SensorEmulator &sensor) : sensor(sensor) {
+    sync();
+}
+
+
+uint64_t SensorStream::sync() {
+    uint64_t host = micros();
+    if (host > sensor.now()) {
+        sensor.advance(host - sensor.now());
+    }
+    else if (sensor.now() > host) {
+        hostAdvance((unsigned long)(sensor.now() - host));
+    }
+    return sensor.now();
+}
+
+
+int SensorStream::available() {
+    sync();
+    return sensor.available();
+}
+
+
+int SensorStream::read() {
+    sync();
+    int b = sensor.read();
+    sync();
+    return b;
+}
+
+
+int SensorStream::peek() {
+    sync();
+    return sensor.peek();
+}
+
+
+size_t SensorStream::write(uint8_t b) {
+    sync();
+    sensor.write(b);
+    sync();
+    return 1;
+}
@@ -0,0 +1,40 @@
+/**
+ * Sensor Emulator Stream.
+ *
+ * Puts a SensorEmulator behind the Arduino Stream interface so the real
+ * Adafruit_Fingerprint library can talk to it, the same way the firmware
+ * hands it the sensor's SoftwareSerial.
+ *
+ * The emulator and the host Arduino core each keep a virtual clock. Every
+ * call first brings the one that is behind up to the other: delay() in
+ * the library moves the emulator on, and a command the emulator spends
+ * time on moves millis() on.
+*/
+
+#ifndef SENSOR_STREAM_H
+#define SENSOR_STREAM_H
+
+#include <Arduino.h>
+#include "sensor_emulator.h"
+
+
+class SensorStream : public Stream {
+    public:
+        explicit SensorStream(SensorEmulator &sensor);
+
+        int available() override;
+        int read() override;
+        int peek() override;
+        size_t write(uint8_t b) override;
+        using Print::write;
+
+        /**
+         * Bring both clocks to the same time and return it in us.
+        */
+        uint64_t sync();
+
+    private:
+        SensorEmulator &sensor;
+};
+
+#endif
@@ -0,0 +1,91 @@
+"""
+Build-time check: delay() is only allowed inside setup().
+
+Runtime code runs from the scheduler and must never block the loop, waits
+there are deadlines on the main loop instead. The check strips comments
+and string literals from the firmware sources, finds every call to
+delay() and fails the build when one sits outside the body of setup().
+
+Runs before the nodemcuv2 build (extra_scripts in platformio.ini), or by
+hand: python3 scripts/check_delay.py
+"""
+
+import os
+import re
+import sys
+
+CALL = re.compile(r"(?<![\w.>])delay\s*\(")
+FUNCTION = re.compile(r"([A-Za-z_]\w*)\s*\([^;{}]*\)\s*(?:const\s*)?\{")
+
+
+def strip(text):
+    """Blank out comments and literals, keeping offsets and newlines."""
+    pattern = re.compile(r'//[^\n]*|/\*.*?\*/|"(?:\\.|[^"\\])*"|\'(?:\\.|[^\'\\])*\'', re.S)
+    return pattern.sub(lambda m: re.sub(r"[^\n]", " ", m.group(0)), text)
+
+
+def top_level_bodies(code):
+    """Yield (name, start, end) for each function defined at file scope."""
+    depth = 0
+    pos = 0
+    while pos < len(code):
+        char = code[pos]
+        if depth == 0:
+            match = FUNCTION.match(code, pos)
+            if match:
+                start = match.end() - 1
+                end = start
+                level = 0
+                while end < len(code):
+                    if code[end] == "{":
+                        level += 1
+                    elif code[end] == "}":
+                        level -= 1
+                        if level == 0:
+                            break
+                    end += 1
+                yield match.group(1), start, end
+                pos = end + 1
+                continue
+        if char == "{":
+            depth += 1
+        elif char == "}":
+            depth -= 1
+        pos += 1
+
+
+def check(src_dir):
+    problems = []
+    for root, dirs, files in os.walk(src_dir):
+        dirs[:] = [d for d in dirs if d != "native"]
+        for name in sorted(files):
+            if not name.endswith((".cpp", ".c", ".ino")):
+                continue
+            path = os.path.join(root, name)
+            with open(path) as f:
+                code = strip(f.read())
+
+            allowed = [(s, e) for fn, s, e in top_level_bodies(code) if fn == "setup"]
+            for call in CALL.finditer(code):
+                if any(s <= call.start() <= e for s, e in allowed):
+                    continue
+                line = code.count("\n", 0, call.start()) + 1
+                problems.append("%s:%d: delay() outside setup()" % (path, line))
+    return problems
+
+
+def report(src_dir):
+    problems = check(src_dir)
+    for problem in problems:
+        print(problem)
+    return not problems
+
+
+try:
+    Import("env")  # noqa: F821, provided by PlatformIO
+    if not report(env.subst("$PROJECT_SRC_DIR")):  # noqa: F821
+        env.Exit(1)  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        here = os.path.dirname(os.path.abspath(__file__))
+        sys.exit(0 if report(os.path.join(here, "..", "src")) else 1)
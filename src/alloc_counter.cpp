@@ -0,0 +1,34 @@
+#include "alloc_counter.h"
+
+static volatile uint32_t alloc_count = 0;
+
+
+uint32_t allocCount() {
+    return alloc_count;
+}
+
+
+#ifdef ALLOC_COUNTER
+
+extern "C" {
+    void *__real_malloc(size_t size);
+    void *__real_calloc(size_t count, size_t size);
+    void *__real_realloc(void *ptr, size_t size);
+
+    void *__wrap_malloc(size_t size) {
+        alloc_count++;
+        return __real_malloc(size);
+    }
+
+    void *__wrap_calloc(size_t count, size_t size) {
+        alloc_count++;
+        return __real_calloc(count, size);
+    }
+
+    void *__wrap_realloc(void *ptr, size_t size) {
+        alloc_count++;
+        return __real_realloc(ptr, size);
+    }
+}
+
+#endif
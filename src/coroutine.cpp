@@ -0,0 +1,45 @@
+#include "coroutine.h"
+
+
+void startCoroutine(Coroutine &co) {
+    co.line = 0;
+    co.started = millis();
+    co.stats.starts++;
+}
+
+
+bool resumeCoroutine(Coroutine &co, CoroutineFunction step) {
+    unsigned long started = micros();
+    int state = step();
+    unsigned long took = micros() - started;
+
+    co.stats.resumes++;
+    if (took > co.stats.max_us) {
+        co.stats.max_us = took;
+    }
+    if (state != CO_DONE) {
+        return false;
+    }
+
+    unsigned long total = millis() - co.started;
+    if (total > co.stats.max_ms) {
+        co.stats.max_ms = total;
+    }
+    return true;
+}
+
+
+void printCoroutine(Print &out, const char *name, const Coroutine &co, size_t context) {
+    out.print(name);
+    out.print(" bytes=");
+    out.print((unsigned long)context);
+    out.print(" starts=");
+    out.print(co.stats.starts);
+    out.print(" resumes=");
+    out.print(co.stats.resumes);
+    out.print(" max_step(us)=");
+    out.print(co.stats.max_us);
+    out.print(" max_total(ms)=");
+    out.print(co.stats.max_ms);
+    out.print("\n");
+}
@@ -0,0 +1,97 @@
+#include "cpu_boost.h"
+
+extern "C" {
+#include "user_interface.h"
+}
+
+static const char *const section_names[BOOST_SECTIONS] = { "convert", "search", "model" };
+
+static BoostTiming timings[BOOST_SECTIONS][2];  // [section][0 base, 1 boosted]
+static bool boost_enabled = false;
+static uint8_t depth = 0;
+static bool raised = false;     // the outermost scope switched the clock
+static uint32_t boost_cycles = 0;   // cycle count when the clock went up
+static uint32_t skew = 0;
+static void (*hook)() = nullptr;
+
+
+static void setClock(uint8_t mhz) {
+    system_update_cpu_freq(mhz);
+    if (hook) {
+        hook();
+    }
+}
+
+
+CpuBoost::CpuBoost(BoostSection section) : section(section) {
+    if (depth++ == 0) {
+        raised = boost_enabled;
+        if (raised) {
+            setClock(CPU_BOOST_MHZ);
+            boost_cycles = ESP.getCycleCount();
+        }
+    }
+    boosted = raised;
+    started_us = micros();
+}
+
+
+CpuBoost::~CpuBoost() {
+    unsigned long took = micros() - started_us;
+    BoostTiming &timing = timings[section][boosted ? 1 : 0];
+    timing.runs++;
+    timing.total_us += took;
+    if (took > timing.max_us) {
+        timing.max_us = took;
+    }
+
+    if (--depth == 0 && raised) {
+        // only the cycles above the base clock's are skew.
+        uint32_t cycles = ESP.getCycleCount() - boost_cycles;
+        skew += cycles - cycles / (CPU_BOOST_MHZ / CPU_BASE_MHZ);
+        setClock(CPU_BASE_MHZ);
+    }
+}
+
+
+void setCpuBoost(bool enabled) {
+    boost_enabled = enabled;
+}
+
+
+void setCpuBoostHook(void (*changed)()) {
+    hook = changed;
+}
+
+
+uint32_t cpuBoostSkew() {
+    return skew;
+}
+
+
+void resetCpuBoostStats() {
+    memset(timings, 0, sizeof(timings));
+}
+
+
+void printCpuBoostStats(Print &out) {
+    for (uint8_t i = 0; i < BOOST_SECTIONS; i++) {
+        out.print("boost ");
+        out.print(section_names[i]);
+        for (uint8_t clock = 0; clock < 2; clock++) {
+            const BoostTiming &timing = timings[i][clock];
+            out.print(" @");
+            out.print(clock ? CPU_BOOST_MHZ : CPU_BASE_MHZ);
+            out.print(" runs=");
+            out.print(timing.runs);
+            out.print(" avg(us)=");
+            out.print(timing.runs ? (unsigned long)(timing.total_us / timing.runs) : 0);
+            out.print(" max(us)=");
+            out.print(timing.max_us);
+        }
+        out.print("\n");
+    }
+    out.print("boost ");
+    out.print(boost_enabled ? "on" : "off");
+    out.print("\n");
+}
@@ -0,0 +1,91 @@
+#include "frame_governor.h"
+
+
+FrameGovernor::FrameGovernor(unsigned long interval, unsigned long max_interval) {
+    min_interval_us = interval * 1000;
+    max_interval_us = max_interval * 1000;
+    interval_us = min_interval_us;
+    resetStats();
+}
+
+
+bool FrameGovernor::due(unsigned long now_us, bool pending) {
+    if (!started) {
+        // first call or resumed after pause(), no gap to measure yet.
+        started = true;
+        last_call_us = now_us;
+        last_frame_us = now_us - min_interval_us;
+    }
+    else {
+        unsigned long gap = now_us - last_call_us;
+        last_call_us = now_us;
+        if (gap > stats.max_work_us) {
+            stats.max_work_us = gap;
+        }
+
+        // running average, work_us += (gap - work_us) / 8
+        if (gap >= work_us) {
+            work_us += (gap - work_us) >> GOVERNOR_AVERAGE_SHIFT;
+        }
+        else {
+            work_us -= (work_us - gap) >> GOVERNOR_AVERAGE_SHIFT;
+        }
+    }
+
+    interval_us = min_interval_us;
+    if (work_us > GOVERNOR_IDLE_US) {
+        interval_us += (work_us - GOVERNOR_IDLE_US) * GOVERNOR_LOAD_SCALE;
+        if (interval_us > max_interval_us) {
+            interval_us = max_interval_us;
+        }
+    }
+
+    unsigned long elapsed = now_us - last_frame_us;
+    if (elapsed < min_interval_us) {
+        return false;
+    }
+    if (elapsed < interval_us) {
+        if (!deferring) {
+            stats.deferred++;
+            deferring = true;
+        }
+        return false;
+    }
+
+    // give this frame's slot to the pending work, try again an interval later.
+    last_frame_us = now_us;
+    deferring = false;
+    if (pending) {
+        stats.dropped++;
+        return false;
+    }
+    return true;
+}
+
+
+void FrameGovernor::drawn(unsigned long now_us) {
+    last_call_us = now_us;
+    stats.frames++;
+}
+
+
+void FrameGovernor::resetStats() {
+    memset(&stats, 0, sizeof(stats));
+}
+
+
+void FrameGovernor::printStats(Print &out) {
+    out.print("anim frames=");
+    out.print(stats.frames);
+    out.print(" dropped=");
+    out.print(stats.dropped);
+    out.print(" deferred=");
+    out.print(stats.deferred);
+    out.print(" interval(ms)=");
+    out.print(interval());
+    out.print(" work(us)=");
+    out.print(work_us);
+    out.print(" maxWork(us)=");
+    out.print(stats.max_work_us);
+    out.print("\n");
+}
@@ -0,0 +1,140 @@
+#include "glyph_cache.h"
+
+#define ROW_PIXELS (LCD_COLS * GLYPH_WIDTH)
+
+
+GlyphCache::GlyphCache(LcdI2C &lcd, const LcdBuffer &screen) : lcd(lcd), screen(screen) {
+    invalidate();
+    memset(&stats, 0, sizeof(stats));
+}
+
+
+void GlyphCache::invalidate() {
+    memset(loaded, 0, sizeof(loaded));
+    memset(used_in, 0, sizeof(used_in));
+}
+
+
+void GlyphCache::beginFrame() {
+    frame++;
+    if (frame == 0) {
+        // wrapped, age every slot the same so none looks pinned.
+        memset(used_in, 0, sizeof(used_in));
+        frame = 1;
+    }
+}
+
+
+int GlyphCache::use(const uint8_t bitmap[GLYPH_ROWS]) {
+    int victim = GLYPH_NONE;
+
+    for (uint8_t slot = 0; slot < GLYPH_SLOTS; slot++) {
+        if (loaded[slot] && memcmp(bitmaps[slot], bitmap, GLYPH_ROWS) == 0) {
+            used_in[slot] = frame;
+            stats.hits++;
+            return slot;
+        }
+
+        // prefer an empty slot, then the one idle for the longest.
+        if (used_in[slot] == frame || (loaded[slot] && screen.showing(slot))) {
+            continue;
+        }
+        if (victim == GLYPH_NONE
+            || (!loaded[slot] && loaded[victim])
+            || (loaded[slot] == loaded[victim] && used_in[slot] < used_in[victim])) {
+            victim = slot;
+        }
+    }
+
+    if (victim == GLYPH_NONE) {
+        stats.misses++;
+        return GLYPH_NONE;
+    }
+
+    if (loaded[victim]) {
+        stats.evictions++;
+    }
+    memcpy(bitmaps[victim], bitmap, GLYPH_ROWS);
+    loaded[victim] = true;
+    used_in[victim] = frame;
+    lcd.createChar(victim, bitmap);
+    stats.uploads++;
+    return victim;
+}
+
+
+void GlyphCache::printStats(Print &out) {
+    out.print("glyphs hits=");
+    out.print(stats.hits);
+    out.print(" uploads=");
+    out.print(stats.uploads);
+    out.print(" evictions=");
+    out.print(stats.evictions);
+    out.print(" misses=");
+    out.print(stats.misses);
+    out.print("\n");
+}
+
+
+void drawSprites(LcdBuffer &screen, GlyphCache &glyphs, uint8_t row,
+                 const uint8_t *const sprites[], const uint8_t positions[], uint8_t count) {
+    uint8_t cells[LCD_COLS][GLYPH_ROWS];
+    memset(cells, 0, sizeof(cells));
+
+    // a sprite k pixels into a cell spills its right part into the next.
+    for (uint8_t s = 0; s < count; s++) {
+        uint8_t px = positions[s] % ROW_PIXELS;
+        uint8_t left = px / GLYPH_WIDTH;
+        uint8_t right = (left + 1) % LCD_COLS;
+        uint8_t k = px % GLYPH_WIDTH;
+
+        for (uint8_t y = 0; y < GLYPH_ROWS; y++) {
+            uint8_t bits = sprites[s][y] & 0x1F;
+            cells[left][y] |= bits >> k;
+            if (k > 0) {
+                cells[right][y] |= (bits << (GLYPH_WIDTH - k)) & 0x1F;
+            }
+        }
+    }
+
+    screen.setCursor(0, row);
+    for (uint8_t c = 0; c < LCD_COLS; c++) {
+        bool empty = true;
+        for (uint8_t y = 0; y < GLYPH_ROWS && empty; y++) {
+            empty = cells[c][y] == 0;
+        }
+
+        int code = empty ? GLYPH_NONE : glyphs.use(cells[c]);
+        screen.write(code == GLYPH_NONE ? ' ' : (uint8_t)code);
+    }
+}
+
+
+void drawProgress(LcdBuffer &screen, GlyphCache &glyphs, uint8_t row, uint16_t value, uint16_t max) {
+    if (max == 0) {
+        max = 1;
+    }
+    if (value > max) {
+        value = max;
+    }
+    uint16_t filled = (uint32_t)value * ROW_PIXELS / max;
+
+    screen.setCursor(0, row);
+    for (uint8_t c = 0; c < LCD_COLS; c++) {
+        uint16_t start = c * GLYPH_WIDTH;
+        if (filled >= start + GLYPH_WIDTH) {
+            screen.write(LCD_FULL_BLOCK);
+        }
+        else if (filled <= start) {
+            screen.write(' ');
+        }
+        else {
+            // the one partially filled cell, its columns lit from the left.
+            uint8_t bits = (0x1F << (GLYPH_WIDTH - (filled - start))) & 0x1F;
+            uint8_t partial[GLYPH_ROWS];
+            memset(partial, bits, sizeof(partial));
+            int code = glyphs.use(partial);
+            screen.write(code == GLYPH_NONE ? ' ' : (uint8_t)code);
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#include "heap_telemetry.h"
+
+
+void HeapTelemetry::track() {
+    uint32_t free = ESP.getFreeHeap();
+    if (free < min_free) {
+        min_free = free;
+    }
+}
+
+
+HeapSample HeapTelemetry::measure(unsigned long now) {
+    HeapSample sample;
+    ESP.getHeapStats(&sample.free, &sample.max_block, &sample.fragmentation);
+    if (sample.free < min_free) {
+        min_free = sample.free;
+    }
+    sample.at = now / 1000;
+    sample.min_free = min_free;
+    sample.stack_free = ESP.getFreeContStack();
+    return sample;
+}
+
+
+void HeapTelemetry::sample(unsigned long now) {
+    samples[(head + count) % HEAP_SAMPLES] = measure(now);
+    if (count < HEAP_SAMPLES) {
+        count++;
+    }
+    else {
+        head = (head + 1) % HEAP_SAMPLES;
+    }
+}
+
+
+void HeapTelemetry::format(const HeapSample &sample, char *text, size_t size) {
+    snprintf(text, size, "free=%lu block=%lu frag=%u min=%lu stack=%lu",
+             (unsigned long)sample.free, (unsigned long)sample.max_block,
+             (unsigned)sample.fragmentation, (unsigned long)sample.min_free,
+             (unsigned long)sample.stack_free);
+}
+
+
+void HeapTelemetry::print(Print &out) {
+    char text[80];
+    for (uint8_t i = 0; i < count; i++) {
+        const HeapSample &sample = samples[(head + i) % HEAP_SAMPLES];
+        format(sample, text, sizeof(text));
+        out.print("heap at(s)=");
+        out.print(sample.at);
+        out.print(" ");
+        out.print(text);
+        out.print("\n");
+    }
+}
@@ -0,0 +1,105 @@
+#include "idle_mode.h"
+
+static const char *const wake_names[WAKE_CAUSES] = { "touch", "scan", "server" };
+
+
+IdleMode::IdleMode(unsigned long timeout) : timeout(timeout) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+
+void IdleMode::activity(unsigned long now) {
+    last_activity = now;
+}
+
+
+bool IdleMode::due(unsigned long now) const {
+    return !is_idle && now - last_activity >= timeout;
+}
+
+
+void IdleMode::enter(unsigned long now) {
+    account(now);
+    is_idle = true;
+    scan_pending = false;
+    stats.sleeps++;
+}
+
+
+void IdleMode::leave(unsigned long now, WakeCause cause, unsigned long stamp) {
+    if (!is_idle) {
+        return;
+    }
+
+    account(now);
+    is_idle = false;
+    last_activity = now;
+    stats.wakes[cause]++;
+
+    // only a touch says when the finger arrived.
+    scan_pending = cause == WAKE_TOUCH;
+    wake_stamp = stamp;
+}
+
+
+void IdleMode::scanned(unsigned long now_us) {
+    if (!scan_pending) {
+        return;
+    }
+    scan_pending = false;
+
+    unsigned long took = now_us - wake_stamp;
+    stats.scans++;
+    stats.last_scan_us = took;
+    stats.total_scan_us += took;
+    if (took > stats.max_scan_us) {
+        stats.max_scan_us = took;
+    }
+}
+
+
+void IdleMode::account(unsigned long now) {
+    unsigned long spent = now - accounted;
+    if (is_idle) {
+        stats.idle_ms += spent;
+    }
+    else {
+        stats.active_ms += spent;
+    }
+    accounted = now;
+}
+
+
+void IdleMode::resetStats(unsigned long now) {
+    memset(&stats, 0, sizeof(stats));
+    accounted = now;
+}
+
+
+void IdleMode::printStats(Print &out, unsigned long now) {
+    account(now);
+    uint64_t total = stats.idle_ms + stats.active_ms;
+
+    out.print("idle ");
+    out.print(is_idle ? "on" : "off");
+    out.print(" sleeps=");
+    out.print(stats.sleeps);
+    for (uint8_t i = 0; i < WAKE_CAUSES; i++) {
+        out.print(" ");
+        out.print(wake_names[i]);
+        out.print("=");
+        out.print(stats.wakes[i]);
+    }
+    out.print(" idle(%)=");
+    out.print(total ? (unsigned long)(stats.idle_ms * 100 / total) : 0);
+    out.print(" avg(mA,est)=");
+    out.print(total ? (unsigned long)((stats.active_ms * IDLE_ACTIVE_MA + stats.idle_ms * IDLE_SLEEP_MA) / total)
+                    : IDLE_ACTIVE_MA);
+    out.print(" wakeToScan(us) last=");
+    out.print(stats.last_scan_us);
+    out.print(" avg=");
+    out.print(stats.scans ? (unsigned long)(stats.total_scan_us / stats.scans) : 0);
+    out.print(" max=");
+    out.print(stats.max_scan_us);
+    out.print("\n");
+}
@@ -0,0 +1,128 @@
+#include "lcd_buffer.h"
+
+// an unchanged cell between two changed ones costs the same as a new
+// cursor command, so runs separated by up to this many cells are merged.
+#define LCD_MERGE_GAP 1
+
+
+LcdBuffer::LcdBuffer(LcdI2C &lcd) : lcd(lcd) {
+    memset(cells, ' ', sizeof(cells));
+    memset(shown, ' ', sizeof(shown));
+    resetStats();
+}
+
+
+void LcdBuffer::setCursor(uint8_t col, uint8_t row) {
+    this->col = col;
+    this->row = row < LCD_ROWS ? row : LCD_ROWS - 1;
+    stats.direct_bytes++;
+}
+
+
+size_t LcdBuffer::write(uint8_t c) {
+    stats.direct_bytes++;
+    // past the last column the HD44780 writes to DDRAM that is not
+    // visible on a 16x2, so those characters are dropped here.
+    if (col < LCD_COLS) {
+        cells[row][col] = c;
+    }
+    col++;
+    return 1;
+}
+
+
+void LcdBuffer::invalidate() {
+    stale = true;
+}
+
+
+uint16_t LcdBuffer::refresh() {
+    uint16_t sent = 0;
+    bool failed = false;
+    uint32_t bus_before = lcd.i2c_bytes;
+    unsigned long started = micros();
+
+    for (uint8_t r = 0; r < LCD_ROWS && !failed; r++) {
+        uint8_t c = 0;
+        while (c < LCD_COLS) {
+            if (!stale && cells[r][c] == shown[r][c]) {
+                c++;
+                continue;
+            }
+
+            // find the end of this run, absorbing short unchanged gaps.
+            uint8_t end = c + 1;
+            uint8_t gap = 0;
+            for (uint8_t i = end; i < LCD_COLS; i++) {
+                if (stale || cells[r][i] != shown[r][i]) {
+                    end = i + 1;
+                    gap = 0;
+                }
+                else if (++gap > LCD_MERGE_GAP) {
+                    break;
+                }
+            }
+
+            if (!lcd.writeRun(c, r, &cells[r][c], end - c)) {
+                // the run may be half written, rewrite every cell once
+                // the bus is back.
+                failed = true;
+                break;
+            }
+            memcpy(&shown[r][c], &cells[r][c], end - c);
+            sent += 1 + end - c;
+            c = end;
+        }
+    }
+
+    stale = failed;
+    if (sent > 0) {
+        stats.frames++;
+        stats.sent_bytes += sent;
+        stats.i2c_bytes += lcd.i2c_bytes - bus_before;
+        stats.busy_us += micros() - started;
+    }
+    else {
+        stats.idle_frames++;
+    }
+    return sent;
+}
+
+
+bool LcdBuffer::showing(uint8_t c) const {
+    if (stale) {
+        return false;
+    }
+    for (uint8_t r = 0; r < LCD_ROWS; r++) {
+        if (memchr(shown[r], c, LCD_COLS)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void LcdBuffer::resetStats() {
+    memset(&stats, 0, sizeof(stats));
+}
+
+
+void LcdBuffer::printStats(Print &out) {
+    uint32_t refreshes = stats.frames + stats.idle_frames;
+
+    out.print("lcd refreshes=");
+    out.print(refreshes);
+    out.print(" idle=");
+    out.print(stats.idle_frames);
+    out.print(" i2cBytesPerFrame direct=");
+    out.print(refreshes ? stats.direct_bytes * LCD_DIRECT_I2C_BYTES_PER_BYTE / refreshes : 0);
+    out.print(" buffered=");
+    out.print(refreshes ? stats.i2c_bytes / refreshes : 0);
+    out.print(" usPerFrame=");
+    out.print(stats.frames ? stats.busy_us / stats.frames : 0);
+    out.print(" busErrors=");
+    out.print(lcd.bus_errors);
+    out.print(" recoveries=");
+    out.print(lcd.recoveries);
+    out.print("\n");
+}
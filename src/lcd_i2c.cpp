@@ -0,0 +1,264 @@
+#include "lcd_i2c.h"
+
+// HD44780 instructions
+#define LCD_CLEARDISPLAY 0x01
+#define LCD_ENTRYMODESET 0x04
+#define LCD_DISPLAYCONTROL 0x08
+#define LCD_FUNCTIONSET 0x20
+#define LCD_SETCGRAMADDR 0x40
+#define LCD_SETDDRAMADDR 0x80
+
+#define LCD_ENTRYLEFT 0x02
+#define LCD_DISPLAYON 0x04
+#define LCD_2LINE 0x08
+#define LCD_4BITMODE 0x00
+
+static const uint8_t row_offsets[] = { 0x00, 0x40, 0x14, 0x54 };
+
+
+LcdI2C::LcdI2C(uint8_t address, uint8_t cols, uint8_t rows) :
+    address(address), cols(cols), rows(rows) {}
+
+
+/**
+ * Power-on initialization by instruction, HD44780 datasheet figure 24.
+ * Only called from setup(). The short waits between the instructions
+ * use delayMicroseconds(), the power-up wait counts from boot and has
+ * usually passed by the time setup() gets here.
+*/
+void LcdI2C::init() {
+    // also starts Wire in fast mode.
+    recoverBus();
+
+    while (millis() < LCD_POWER_UP_MS) {
+        yield();
+    }
+    queue(backlight_bit);
+    transmit();
+
+    resynchronize();
+    clear();
+}
+
+
+/**
+ * Three times 8-bit mode, then 4-bit, then the display settings. Works
+ * whatever nibble phase the controller is in, so it also brings it back
+ * after a transmission that was cut short. DDRAM and CGRAM are kept.
+*/
+void LcdI2C::resynchronize() {
+    resync = false;
+
+    queueNibble(0x30);
+    transmit();
+    delayMicroseconds(4500);
+    queueNibble(0x30);
+    transmit();
+    delayMicroseconds(4500);
+    queueNibble(0x30);
+    transmit();
+    delayMicroseconds(150);
+    queueNibble(0x20);
+    transmit();
+
+    command(LCD_FUNCTIONSET | LCD_4BITMODE | LCD_2LINE);
+    command(LCD_DISPLAYCONTROL | LCD_DISPLAYON);
+    command(LCD_ENTRYMODESET | LCD_ENTRYLEFT);
+}
+
+
+/**
+ * Resynchronize the controller if a transmission failed since the last
+ * write, before anything else is sent.
+ * @return false if the bus is still failing.
+*/
+bool LcdI2C::ready() {
+    if (resync) {
+        resynchronize();
+    }
+    return !resync;
+}
+
+
+void LcdI2C::backlight() {
+    backlight_bit = LCD_BACKLIGHT;
+    queue(backlight_bit);
+    transmit();
+}
+
+
+void LcdI2C::noBacklight() {
+    backlight_bit = 0;
+    queue(backlight_bit);
+    transmit();
+}
+
+
+void LcdI2C::clear() {
+    ready();
+    send(LCD_CLEARDISPLAY, 0);
+    transmit();
+    // 1.52 ms instead of the usual command wait.
+    delayMicroseconds(1600);
+}
+
+
+void LcdI2C::setCursor(uint8_t col, uint8_t row) {
+    if (row >= rows) {
+        row = rows - 1;
+    }
+    ready();
+    command(LCD_SETDDRAMADDR | (col + row_offsets[row]));
+}
+
+
+void LcdI2C::createChar(uint8_t slot, const uint8_t bitmap[8]) {
+    ready();
+    command(LCD_SETCGRAMADDR | ((slot & 0x07) << 3));
+    for (uint8_t i = 0; i < 8; i++) {
+        send(bitmap[i], LCD_RS);
+    }
+    transmit();
+}
+
+
+size_t LcdI2C::write(uint8_t c) {
+    if (!ready()) {
+        return 0;
+    }
+    send(c, LCD_RS);
+    return transmit() ? 1 : 0;
+}
+
+
+bool LcdI2C::writeRun(uint8_t col, uint8_t row, const uint8_t *data, uint8_t len) {
+    if (row >= rows) {
+        row = rows - 1;
+    }
+    if (!ready()) {
+        return false;
+    }
+    if (!command(LCD_SETDDRAMADDR | (col + row_offsets[row]))) {
+        return false;
+    }
+    for (uint8_t i = 0; i < len; i++) {
+        send(data[i], LCD_RS);
+    }
+    transmit();
+    // a batch flushed by queueNibble() may have failed as well.
+    return !resync;
+}
+
+
+/**
+ * Send an instruction and wait until it has executed, the controller
+ * ignores whatever arrives while it is busy.
+ * @return false if the transmission failed.
+*/
+bool LcdI2C::command(uint8_t value) {
+    send(value, 0);
+    bool sent = transmit();
+    delayMicroseconds(LCD_COMMAND_US);
+    return sent;
+}
+
+
+void LcdI2C::send(uint8_t value, uint8_t mode) {
+    queueNibble((value & 0xF0) | mode);
+    queueNibble(((value << 4) & 0xF0) | mode);
+}
+
+
+/**
+ * The data lines are latched on the falling edge of EN, so a nibble is
+ * the bits with EN high followed by the same bits with EN low. RS has to
+ * settle before EN rises, so a change of RS gets its own write first.
+*/
+void LcdI2C::queueNibble(uint8_t bits) {
+    bits |= backlight_bit;
+    if (!batching) {
+        // LiquidCrystal_I2C: data, EN high, EN low, each on its own.
+        queue(bits);
+        transmit();
+        queue(bits | LCD_EN);
+        transmit();
+        queue(bits & ~LCD_EN);
+        transmit();
+        return;
+    }
+
+    if (batch_len + 3 > LCD_I2C_BATCH) {
+        transmit();
+    }
+    if ((bits ^ last_bits) & LCD_RS) {
+        queue(bits);
+    }
+    queue(bits | LCD_EN);
+    queue(bits & ~LCD_EN);
+    last_bits = bits;
+}
+
+
+void LcdI2C::queue(uint8_t b) {
+    batch[batch_len++] = b;
+}
+
+
+bool LcdI2C::transmit() {
+    if (batch_len == 0) {
+        return true;
+    }
+
+    for (uint8_t attempt = 0; attempt < 2; attempt++) {
+        Wire.beginTransmission(address);
+        for (uint8_t i = 0; i < batch_len; i++) {
+            Wire.write(batch[i]);
+        }
+        transmissions++;
+        i2c_bytes += batch_len + 1;
+
+        if (Wire.endTransmission() == 0) {
+            batch_len = 0;
+            return true;
+        }
+        bus_errors++;
+        recoverBus();
+    }
+
+    // part of the batch may have been latched, leaving the controller
+    // half way through a byte.
+    batch_len = 0;
+    resync = true;
+    return false;
+}
+
+
+bool LcdI2C::recoverBus() {
+    pinMode(SDA, INPUT_PULLUP);
+    pinMode(SCL, INPUT_PULLUP);
+    delayMicroseconds(5);
+
+    bool stuck = digitalRead(SDA) == LOW;
+    if (stuck) {
+        recoveries++;
+        // up to nine clocks let a slave finish the byte it is sending.
+        for (uint8_t i = 0; i < 9 && digitalRead(SDA) == LOW; i++) {
+            pinMode(SCL, OUTPUT);
+            digitalWrite(SCL, LOW);
+            delayMicroseconds(5);
+            pinMode(SCL, INPUT_PULLUP);
+            delayMicroseconds(5);
+        }
+
+        // STOP: SDA rises while SCL is high.
+        pinMode(SDA, OUTPUT);
+        digitalWrite(SDA, LOW);
+        delayMicroseconds(5);
+        pinMode(SDA, INPUT_PULLUP);
+        delayMicroseconds(5);
+    }
+
+    Wire.begin();
+    Wire.setClock(LCD_I2C_CLOCK);
+    return digitalRead(SDA) == HIGH;
+}
@@ -0,0 +1,76 @@
+#include "lcd_screens.h"
+
+static const uint8_t head_sprite[GLYPH_ROWS] = {
+  0b00000,
+  0b00000,
+  0b01110,
+  0b11111,
+  0b11111,
+  0b11111,
+  0b01110,
+  0b00000
+};
+
+static const uint8_t tail_sprite[GLYPH_ROWS] = {
+  0b00000,
+  0b00000,
+  0b00000,
+  0b00100,
+  0b01110,
+  0b00100,
+  0b00000,
+  0b00000
+};
+
+static const uint8_t *const sprites[SCAN_SPRITES] = { head_sprite, tail_sprite, tail_sprite, tail_sprite };
+static const uint8_t sprites_start[SCAN_SPRITES] = { 15, 10, 5, 0 };
+
+
+void drawScreenText(LcdBuffer &screen, ScreenText text) {
+    screen.setCursor(0, 0);
+    screen.print(FPSTR(screenLine(text, 0)));
+    screen.setCursor(0, 1);
+    screen.print(FPSTR(screenLine(text, 1)));
+}
+
+
+void showScreenText(LcdBuffer &screen, ScreenText text) {
+    drawScreenText(screen, text);
+    screen.refresh();
+}
+
+
+void showProgress(LcdBuffer &screen, GlyphCache &glyphs, ScreenText text, uint16_t step, uint16_t steps) {
+    glyphs.beginFrame();
+    drawScreenText(screen, text);
+    drawProgress(screen, glyphs, 1, step, steps);
+    screen.refresh();
+}
+
+
+void initDisplay(LcdI2C &lcd, LcdBuffer &screen, GlyphCache &glyphs) {
+    lcd.init();
+    lcd.backlight();
+
+    glyphs.invalidate();
+    screen.invalidate();
+
+    showScreenText(screen, TEXT_CLIENT_START);
+}
+
+
+void resetScanAnimation(ScanAnimation &animation) {
+    memcpy(animation.positions, sprites_start, sizeof(animation.positions));
+}
+
+
+void drawScanFrame(LcdBuffer &screen, GlyphCache &glyphs, ScanAnimation &animation) {
+    glyphs.beginFrame();
+    drawScreenText(screen, animation.mode == SCAN_ENROLL ? TEXT_ENROLL_SCAN : TEXT_SCAN);
+
+    drawSprites(screen, glyphs, 1, sprites, animation.positions, SCAN_SPRITES);
+    for (uint8_t i = 0; i < SCAN_SPRITES; i++) {
+        animation.positions[i] = (animation.positions[i] + GLYPH_WIDTH) % (LCD_COLS * GLYPH_WIDTH);
+    }
+    screen.refresh();
+}
@@ -0,0 +1,40 @@
+#include "line_outbox.h"
+
+
+bool LineOutbox::push(const char *line) {
+    if (count >= OUTBOX_LINES) {
+        dropped++;
+        return false;
+    }
+
+    char *slot = lines[(head + count) % OUTBOX_LINES];
+    strncpy(slot, line ? line : "", OUTBOX_LINE_SIZE - 1);
+    slot[OUTBOX_LINE_SIZE - 1] = '\0';
+    count++;
+    return true;
+}
+
+
+bool LineOutbox::push(long value) {
+    char text[12];
+    snprintf(text, sizeof(text), "%ld", value);
+    return push(text);
+}
+
+
+bool LineOutbox::sendNext(Print &out) {
+    if (count == 0) {
+        return false;
+    }
+
+    out.println(lines[head]);
+    head = (head + 1) % OUTBOX_LINES;
+    count--;
+    return true;
+}
+
+
+void LineOutbox::flush(Print &out) {
+    while (sendNext(out)) {
+    }
+}
@@ -0,0 +1,36 @@
+#include "line_reader.h"
+
+
+bool LineReader::poll(Stream &in) {
+    if (complete) {
+        // the previous line has been handled, start the next one.
+        complete = false;
+        cut = false;
+        length = 0;
+    }
+
+    while (in.available() > 0) {
+        int c = in.read();
+        if (c < 0) {
+            break;
+        }
+        if (c == '\n') {
+            text[length] = '\0';
+            complete = true;
+            if (cut) {
+                truncated++;
+            }
+            return true;
+        }
+        if (c == '\r') {
+            continue;
+        }
+        if (length < LINE_READER_SIZE - 1) {
+            text[length++] = (char)c;
+        }
+        else {
+            cut = true;
+        }
+    }
+    return false;
+}
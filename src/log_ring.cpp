@@ -0,0 +1,137 @@
+#include "log_ring.h"
+
+
+LogRing::LogRing(Print &sink) : sink(&sink) {
+}
+
+
+size_t LogRing::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+
+size_t LogRing::write(const uint8_t *buffer, size_t size) {
+    size_t direct = 0;
+    if (count == 0 && !prefix[0]) {
+        int room = sink->availableForWrite();
+        if (room > 0) {
+            direct = sink->write(buffer, (size_t)room < size ? (size_t)room : size);
+        }
+    }
+
+    size_t queued = 0;
+    for (size_t i = direct; i < size && count < LOG_RING_SIZE; i++) {
+        data[(head + count) % LOG_RING_SIZE] = buffer[i];
+        count++;
+        queued++;
+    }
+    if (count > peak) {
+        peak = count;
+    }
+
+    // the caller never waits, so report everything as taken.
+    dropped += size - direct - queued;
+    written += direct + queued;
+    return size;
+}
+
+
+void LogRing::drain() {
+    if (prefix[0]) {
+        while (drainLine()) {
+        }
+        return;
+    }
+
+    while (count > 0) {
+        int room = sink->availableForWrite();
+        if (room <= 0) {
+            return;
+        }
+
+        // up to the end of the ring, the rest on the next turn.
+        size_t span = LOG_RING_SIZE - head;
+        size_t len = count < span ? count : span;
+        if ((size_t)room < len) {
+            len = room;
+        }
+        size_t sent = sink->write(data + head, len);
+        if (sent == 0) {
+            return;
+        }
+        head = (head + sent) % LOG_RING_SIZE;
+        count -= sent;
+    }
+}
+
+
+/**
+ * Pass on the oldest whole line with the prefix in front.
+ * @return true if a line was taken out of the ring.
+*/
+bool LogRing::drainLine() {
+    if (count == 0 || (gate && !gate())) {
+        return false;
+    }
+
+    size_t len = 0;
+    while (len < count && len < LOG_LINE_MAX && data[(head + len) % LOG_RING_SIZE] != '\n') {
+        len++;
+    }
+    bool ended = len < count && data[(head + len) % LOG_RING_SIZE] == '\n';
+    // a longer line goes out in pieces, the room for it may never come.
+    if (!ended && len < LOG_LINE_MAX) {
+        return false;
+    }
+    size_t taken = ended ? len + 1 : len;
+
+    if (len > 0) {
+        size_t prefix_len = strlen(prefix);
+        int room = sink->availableForWrite();
+        if (room < 0 || (size_t)room < prefix_len + len + 1) {
+            return false;
+        }
+        sink->write((const uint8_t *)prefix, prefix_len);
+        size_t span = LOG_RING_SIZE - head;
+        if (len <= span) {
+            sink->write(data + head, len);
+        }
+        else {
+            sink->write(data + head, span);
+            sink->write(data, len - span);
+        }
+        sink->write('\n');
+    }
+
+    head = (head + taken) % LOG_RING_SIZE;
+    count -= taken;
+    return true;
+}
+
+
+void LogRing::route(Print &sink, const char *prefix, LogGate gate) {
+    this->sink = &sink;
+    this->gate = gate;
+    strncpy(this->prefix, prefix ? prefix : "", LOG_PREFIX_SIZE - 1);
+    this->prefix[LOG_PREFIX_SIZE - 1] = '\0';
+}
+
+
+void LogRing::resetStats() {
+    dropped = 0;
+    written = 0;
+    peak = count;
+}
+
+
+void LogRing::printStats(Print &out) {
+    out.print("log written=");
+    out.print(written);
+    out.print(" dropped=");
+    out.print(dropped);
+    out.print(" queued=");
+    out.print((unsigned long)count);
+    out.print(" peak=");
+    out.print((unsigned long)peak);
+    out.print("\n");
+}
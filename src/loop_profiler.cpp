@@ -0,0 +1,104 @@
+#include "loop_profiler.h"
+
+
+LoopProfiler::LoopProfiler() {
+    memset(sections, 0, sizeof(sections));
+    sections[PROFILE_LOOP].name = "loop";
+    sections[PROFILE_COMMAND].name = "command";
+    sections[PROFILE_EVENT].name = "event";
+}
+
+
+void LoopProfiler::name(uint8_t section, const char *name) {
+    if (section < PROFILE_SECTIONS) {
+        sections[section].name = name;
+    }
+}
+
+
+void LoopProfiler::record(uint8_t section, unsigned long us) {
+    if (section >= PROFILE_SECTIONS) {
+        return;
+    }
+
+    ProfileSection &s = sections[section];
+    s.count++;
+    s.total_us += us;
+    if (us > s.max_us) {
+        s.max_us = us;
+    }
+
+    uint8_t bucket = 0;
+    for (unsigned long v = us >> 1; v > 0 && bucket < PROFILE_BUCKETS - 1; v >>= 1) {
+        bucket++;
+    }
+    s.buckets[bucket]++;
+
+    if (us >= PROFILE_STALL_US) {
+        Stall &stall = stalls[(stall_head + stall_count) % PROFILE_STALLS];
+        stall.section = section;
+        stall.us = us;
+        stall.at = millis();
+        if (stall_count < PROFILE_STALLS) {
+            stall_count++;
+        }
+        else {
+            stall_head = (stall_head + 1) % PROFILE_STALLS;
+        }
+    }
+}
+
+
+void LoopProfiler::reset() {
+    for (uint8_t i = 0; i < PROFILE_SECTIONS; i++) {
+        const char *kept = sections[i].name;
+        memset(&sections[i], 0, sizeof(sections[i]));
+        sections[i].name = kept;
+    }
+    stall_head = 0;
+    stall_count = 0;
+}
+
+
+/**
+ * One line per section, histogram buckets as <from us>:<count>, e.g.
+ *  loop n=2000 avg(us)=310 max(us)=41210 hist 128:1500 256:480 32768:20
+*/
+void LoopProfiler::print(Print &out) {
+    for (uint8_t i = 0; i < PROFILE_SECTIONS; i++) {
+        const ProfileSection &s = sections[i];
+        if (s.count == 0) {
+            continue;
+        }
+
+        out.print(s.name ? s.name : "?");
+        out.print(" n=");
+        out.print(s.count);
+        out.print(" avg(us)=");
+        out.print((unsigned long)(s.total_us / s.count));
+        out.print(" max(us)=");
+        out.print(s.max_us);
+        out.print(" hist");
+        for (uint8_t b = 0; b < PROFILE_BUCKETS; b++) {
+            if (s.buckets[b] == 0) {
+                continue;
+            }
+            out.print(" ");
+            out.print(b == 0 ? 0UL : 1UL << b);
+            out.print(":");
+            out.print(s.buckets[b]);
+        }
+        out.print("\n");
+    }
+
+    for (uint8_t i = 0; i < stall_count; i++) {
+        const Stall &stall = stalls[(stall_head + i) % PROFILE_STALLS];
+        out.print("stall ");
+        out.print(sections[stall.section].name ? sections[stall.section].name : "?");
+        out.print(" ");
+        out.print(stall.us);
+        out.print("us at ");
+        out.print(stall.at);
+        out.print("ms\n");
+    }
+}
@@ -10,6 +10,9 @@
  *  GND to NodeMCU GND
  *  TX  to NodeMCU d5 (GPIO14, FINGER_RX)
  *  RX  to NodeMCU d6 (GPIO12, FINGER_TX)
+ *  Touch to NodeMCU d7 (GPIO13, FINGER_TOUCH), high while a finger rests,
+ *  with a 10k pull-down to GND: GPIO13 has no internal pull-down and an
+ *  open or open-drain output floats
  * 
  * Wiring for Liquid Crystal Display: -------------------------------------- *
  * VCC to NodeMCU Vin
@@ -23,55 +26,233 @@
 #include "ESP8266Wifi.h"
 #include "secrets.h"
 #include "SoftwareSerial.h"
-#include "WiFiClient.h"
-#include "LiquidCrystal_I2C.h"
+#include "transport.h"
+#include "lcd_i2c.h"
 #include "string.h"
+#include "packet_trace.h"
+#include "sensor_profile.h"
+#include "lcd_buffer.h"
+#include "screen_manager.h"
+#include "glyph_cache.h"
+#include "screen_text.h"
+#include "alloc_counter.h"
+#include "frame_governor.h"
+#include "scheduler.h"
+#include "line_outbox.h"
+#include "loop_profiler.h"
+#include "soft_watchdog.h"
+#include "coroutine.h"
+#include "line_reader.h"
+#include "event_ring.h"
+#include "idle_mode.h"
+#include "cpu_boost.h"
+#include "log_level.h"
+#include "heap_telemetry.h"
+#include "lcd_screens.h"
 
 #define CLIENT_ID "client1" // change for different clients
 #define FINGER_RX 0x0E // d5
 #define FINGER_TX 0x0C // d6
-
-WiFiClient client;
+#define FINGER_TOUCH 0x0D // d7
+#define EVENT_RING_SIZE 16
+#define ENROLL_STEPS 4
+#define ANIM_MAX_INTERVAL 400 // ms, slowest animation under load
+#define HEARTBEAT_INTERVAL 5000 // ms
+#define SENSOR_POLL_INTERVAL 50 // ms
+#define OUTBOX_INTERVAL 30 // ms between lines sent to the server
+#define REBOOT_DELAY 1000 // ms the reboot screen stays up
+#define ENROLL_BUDGET 60000 // ms for a whole enrollment
+#define SCANNER_BUDGET 10000 // ms of handshake retries before reopening the port
+#define SENSOR_COMMAND_MS DEFAULTTIMEOUT // ms the library waits for a reply
+#define SENSOR_TASK_BUDGET (3 * SENSOR_COMMAND_MS + 500) // ms, a scan run is up to three commands
+#define SCANNER_RECOVER_AFTER 2 // runs over budget in a row before reopening the port
+#define WIFI_BUDGET 30000 // ms before the association is restarted
+#define SERVER_BUDGET 30000 // ms of connect attempts before it is logged
+#define LINE_TIMEOUT 1000 // ms a conversation waits for a server line
+#define ENROLL_REPLY_TIMEOUT 10000 // ms for the server to answer an enrollment
+#define REMOVE_POLL_INTERVAL 2000 // ms between checks for a lifted finger
+#define ENROLL_FIELDS 8 // id, first, middle, last name, age, gender, phone, address
+#define IDLE_POLL_INTERVAL 500 // ms between sensor polls while idle
+#define TOUCH_HOLDOFF 250 // ms after a touch edge in which further edges are ignored
+#ifndef IDLE_TIMEOUT
+#define IDLE_TIMEOUT 120000 // ms without activity before going idle
+#endif
+
+#ifdef TRANSPORT_ASYNC
+AsyncTransport server_link;
+#else
+WiFiTransport server_link;
+#endif
+Transport &client = server_link;
 SoftwareSerial s_serial(FINGER_RX, FINGER_TX);
-Adafruit_Fingerprint finger_scanner = Adafruit_Fingerprint(&s_serial);
-LiquidCrystal_I2C lcd = LiquidCrystal_I2C(0x27, 0x10, 0x02);
-String message;
+TracedStream finger_trace(s_serial);
+Adafruit_Fingerprint finger_scanner = Adafruit_Fingerprint(&finger_trace);
+LcdI2C lcd = LcdI2C(0x27, 0x10, 0x02);
+LcdBuffer screen(lcd);
+GlyphCache glyphs(lcd, screen);
+ScreenManager screens(screen);
+FrameGovernor governor(50, ANIM_MAX_INTERVAL);
+Scheduler scheduler;
+LoopProfiler profiler;
+SoftWatchdog watchdog;
+LineOutbox outbox;
+LineReader server_lines;
+LogRing debug_log(Serial);
+IdleMode idle(IDLE_TIMEOUT);
+EventRing<EVENT_RING_SIZE> events;
+HeapTelemetry heap;
+int heartbeat_task = SCHED_NO_TASK;
+int sensor_task = SCHED_NO_TASK;
+SensorProfile sensor_profile;
+uint32_t protocol_lines = 0;
+uint32_t protocol_allocs = 0;   // while reading and routing lines
+uint32_t command_allocs = 0;    // while executing commands, sends included
 
 unsigned long currentTime = 0;
-unsigned long animInterval = 50;
-unsigned long animPreviousTime = 0;
-unsigned long enrollPrevousTime = 0;
-unsigned long loginPreviousTime = 0;
-unsigned long heartbeatInterval = 5000;
-unsigned long beatPreviousTime = 0;
-unsigned long responseTime = 0;
+unsigned long lineArrivedTime = 0;
+unsigned long foundDwell = 1000;
+unsigned long scanImageTime = 0;
+unsigned long animAllocs = 0;
 
 bool is_connected = false;
-byte sprites_pos[4] = { 0x03, 0x02, 0x01, 0x00 };
-byte scan_mode = 0x00;
-
-byte head_sprite[8] = {
-  0b00000,
-  0b00000,
-  0b01110,
-  0b11111,
-  0b11111,
-  0b11111,
-  0b01110,
-  0b00000
+bool fingerLifted = true;
+bool touchPending = false;      // a touch edge waits for the sensor poll to confirm it
+unsigned long touchStamp = 0;   // micros() of that edge
+unsigned long touchAccepted = 0; // millis() of the last edge acted on
+bool screenHeld = false;
+bool beatTelemetry = false;     // heap figures on the heartbeat, see heartbeatTask()
+
+/**
+ * Conversations with the server run as coroutines, one at a time, see
+ * coroutine.h. Each keeps its state in a fixed context.
+*/
+enum Talk { TALK_NONE, TALK_ENROLL, TALK_SCAN, TALK_DELETE };
+
+// protocol fields, sizes include the terminating 0
+struct EnrollFields {
+    char id[6];
+    char first_name[33];
+    char middle_name[33];
+    char last_name[33];
+    char age[4];
+    char gender[8];
+    char phone_number[16];
+    char address[65];
 };
 
-byte tail_sprite[8] = {
-  0b00000,
-  0b00000,
-  0b00000,
-  0b00100,
-  0b01110,
-  0b00100,
-  0b00000,
-  0b00000
+struct FieldLayout {
+    uint8_t offset;
+    uint8_t size;
 };
 
+#define ENROLL_FIELD(member) { offsetof(EnrollFields, member), sizeof(EnrollFields::member) }
+
+// in the order the server sends them after "enroll"
+const FieldLayout enroll_layout[ENROLL_FIELDS] = {
+    ENROLL_FIELD(id),
+    ENROLL_FIELD(first_name),
+    ENROLL_FIELD(middle_name),
+    ENROLL_FIELD(last_name),
+    ENROLL_FIELD(age),
+    ENROLL_FIELD(gender),
+    ENROLL_FIELD(phone_number),
+    ENROLL_FIELD(address),
+};
+
+struct EnrollContext {
+    Coroutine co;
+    EnrollFields fields;
+    char reply[8];
+    uint8_t field;
+    bool field_too_long;
+    uint16_t id;
+    uint8_t p;
+    bool enrolled;
+    bool reported;          // budget overrun logged
+    unsigned long started;
+};
+
+struct ScanContext {
+    Coroutine co;
+    int id;
+    unsigned long matched;
+    unsigned long dwell;
+    char reply[8];
+    char name[sizeof(EnrollFields::first_name)];
+};
+
+struct DeleteContext {
+    Coroutine co;
+    char text[sizeof(EnrollFields::id)];
+    uint16_t id;
+};
+
+Talk talk = TALK_NONE;
+EnrollContext enroll_talk;
+ScanContext scan_talk;
+DeleteContext delete_talk;
+
+// the line the running conversation asked for, see requestLine().
+bool talkWantsLine = false;
+bool talkLineReady = false;
+char talkLine[LINE_READER_SIZE];
+
+/**
+ * Wait for the next server line, at most timeout ms, then takeLine().
+*/
+#define CO_AWAIT_LINE(co, timeout) \
+    do { requestLine(co); CO_WAIT_UNTIL(co, lineArrived(co, timeout)); } while (0)
+
+enum BootStage { BOOT_WIFI_BEGIN, BOOT_LCD, BOOT_SENSOR, BOOT_WIFI, BOOT_SERVER, BOOT_STAGES };
+const char *bootStageNames[BOOT_STAGES] = { "wifiBegin", "lcd", "sensor", "wifi", "server" };
+unsigned long bootStamps[BOOT_STAGES];
+
+ScanAnimation scan_animation;
+
+
+/**
+ * Read the scanner parameters and store them if they differ from the
+ * profile kept in flash.
+ * @return false if the scanner did not answer, the profile is unchanged.
+*/
+bool probeFingerprintScanner() {
+    SensorProfile probed;
+    if (!probeSensorProfile(finger_scanner, probed)) {
+        LOG_ERROR("\n[i] Could not read scanner parameters.");
+        return false;
+    }
+
+    if (!sensorProfileMatches(probed, sensor_profile)) {
+        LOG_INFO("\n[i] Scanner profile changed, saving.");
+        saveSensorProfile(probed);
+    }
+    sensor_profile = probed;
+    return true;
+}
+
+
+/**
+ * The software serial times its bits in CPU cycles, re-time it after a
+ * clock switch. Switches happen between sensor packets only.
+*/
+void retimeScannerPort() {
+    s_serial.updateBaudRate(57600);
+}
+
+
+/**
+ * A sensor poll or conversation step ran over its budget twice in a row.
+ * The budget covers every sensor command of a run timing out in the
+ * library, so that is not a slow exchange but a port that hangs. Reopen
+ * it as the boot handshake does, conversations give up on their own
+ * budgets.
+*/
+void recoverScanner() {
+    LOG_ERROR("\n[i] Reopening the scanner port.");
+    s_serial.end();
+    s_serial.begin(57600);
+}
+
 
 /**
  * Initialize The Fingerprint Scanner.
@@ -81,34 +262,105 @@ byte tail_sprite[8] = {
  * functions of the code will be pointless therefore,
  * it will keep looping until a fingerprint scanner
  * is found.
+ * 
+ * The scanner parameters are only read when no valid profile is
+ * stored in flash, a stored one is handed to the library instead,
+ * see sensor_profile.h.
+ * 
+ * @note finger_scanner.begin() is not called, with a Stream it only
+ * sleeps a second for the sensor to boot. The sensor boots while the
+ * LCD is set up instead and the handshake is retried until it answers.
 */
 void initFingerprintScanner() {
-    finger_scanner.begin(57600);
-    Serial.print("\n[i] Starting Fingerprint Scanner.");
+    s_serial.begin(57600);
+    setCpuBoostHook(retimeScannerPort);
+    LOG_INFO("\n[i] Starting Fingerprint Scanner.");
+    bool cached = loadSensorProfile(sensor_profile);
 
+    watchdog.begin("scanner", SCANNER_BUDGET);
     while (true) {
         if (finger_scanner.verifyPassword()) {
-            Serial.print("\n[i] Scanner Found !");
+            LOG_INFO("\n[i] Scanner Found !");
             break;
         }
         else {
-            Serial.print("\n[i] Scanner not Found. Retrying...");
+            LOG_INFO("\n[i] Scanner not Found. Retrying...");
         }
-        delay(50);
+
+        debug_log.drain();
+
+        // verifyPassword() waits for the reply itself, that paces retries.
+        if (watchdog.expired()) {
+            watchdog.end();
+            s_serial.end();
+            s_serial.begin(57600);
+            watchdog.begin("scanner", SCANNER_BUDGET);
+        }
+    }
+    watchdog.end();
+
+    if (cached) {
+        applySensorProfile(sensor_profile, finger_scanner);
+    }
+    else if (!probeFingerprintScanner()) {
+        // go by the library's defaults (capacity 64) rather than
+        // whatever the flash held, the next boot probes again.
+        defaultSensorProfile(finger_scanner, sensor_profile);
+    }
+    if (LOG_ENABLED(LOG_LEVEL_INFO)) {
+        debug_log.print("\n[i] ");
+        printSensorProfile(debug_log, sensor_profile);
+    }
+}
+
+
+/**
+ * A slot the stored profile says exists was refused by the scanner,
+ * so the profile no longer describes this scanner. Drop it and let
+ * the next boot probe again.
+*/
+void checkSlotRejected(uint16_t id) {
+    if (id < sensor_profile.capacity) {
+        LOG_ERROR("\n[i] Scanner profile mismatch, will re-probe.");
+        clearSensorProfile();
     }
 }
 
 
+/**
+ * Write a screen from flash into the screen buffer without sending it.
+ * @param text the screen to be displayed, see screen_text.h.
+*/
+void drawText(ScreenText text) {
+	drawScreenText(screen, text);
+}
+
+
 /**
  * Display the text to the Liquid Crystal Display.
- * @param text the text to be displayed. 
+ * Only the characters that changed are sent, see lcd_buffer.h.
+ * @param text the screen to be displayed, see screen_text.h.
 */
-void displayText(String firstLine, String secondLine) {
-	lcd.setCursor(0, 0);
-	lcd.print(firstLine);
-	lcd.setCursor(0, 1);
-	lcd.print(secondLine);
-	delay(2);
+void displayText(ScreenText text) {
+	showScreenText(screen, text);
+}
+
+
+/**
+ * Show a screen's first line over a progress bar, used while enrolling.
+*/
+void displayProgress(ScreenText text, uint16_t step, uint16_t steps) {
+	showProgress(screen, glyphs, text, step, steps);
+}
+
+
+/**
+ * Print how many heap allocations the idle animation made.
+*/
+void printAnimAllocs(Print &out) {
+	out.print("anim allocs=");
+	out.print(animAllocs);
+	out.print("\n");
 }
 
 
@@ -116,95 +368,126 @@ void displayText(String firstLine, String secondLine) {
  * Initialize the Liquid Crystal Display
 */
 void initLCD() {
-    Serial.print("\n[i] Starting LCD.");
-    lcd.init();
-    lcd.backlight();
+    LOG_INFO("\n[i] Starting LCD.");
+    initDisplay(lcd, screen, glyphs);
+    resetScanAnimation(scan_animation);
+}
+
+
+/**
+ * Time a full two row rewrite through the LiquidCrystal_I2C style
+ * nibble path and through the batched backend.
+*/
+void benchLCD(Print &out) {
+	unsigned long rowTime[2];
+
+	for (int batched = 0; batched < 2; batched++) {
+		lcd.setBatching(batched);
+		screen.invalidate();
+		drawText(TEXT_LCD_BENCH);
+		unsigned long started = micros();
+		screen.refresh();
+		rowTime[batched] = (micros() - started) / LCD_ROWS;
+	}
+
+	out.print("lcd row update(us) unbatched=");
+	out.print(rowTime[0]);
+	out.print(" batched=");
+	out.print(rowTime[1]);
+	out.print("\n");
+}
 
-    lcd.createChar(0, head_sprite);
-    lcd.createChar(1, tail_sprite);
 
-    lcd.setCursor(0, 0);
-    displayText("  Client Start  ", "");
+/**
+ * Work the loop will do on its next pass, a frame due now yields to it.
+ * Server data only counts when networkTask() will read it: during a
+ * conversation lines stay queued until it asks for one. The sensor port
+ * is no signal, the library reads each reply inside its own call.
+*/
+bool loopBacklog() {
+	bool reading = talk == TALK_NONE || talkWantsLine;
+	return talkLineReady
+		|| !outbox.empty()
+		|| !events.empty()
+		|| (reading && client.available() > 0);
 }
 
 
 /**
  * This function updates the animation when waiting for a fingerprint scan.
+ * The frame rate follows the load of the loop, see frame_governor.h.
 */
 void scanAnimation() {
-	if (currentTime - animPreviousTime >= animInterval) {
-		switch (scan_mode) {
-			case 0x00:
-			displayText("Scan Your Finger", "                ");
-			break;
-			case 0x01:
-			displayText(" Enroll  Finger ", "                ");
-			break;
-		}
-		
-		for (int i = 0; i < sizeof(sprites_pos) / sizeof(byte); i++) {
-			if (sprites_pos[i] > 0x0F) {
-			sprites_pos[i] = 0x00;
-			}
-
-			lcd.setCursor(sprites_pos[i], 1);
-			if (i == 0) {
-			lcd.write(0);
-			}
-			else {
-			lcd.write(1);
-			}
-			sprites_pos[i]++;
-		}
+	if (governor.due(micros(), loopBacklog())) {
+		uint32_t allocs = allocCount();
+		drawScanFrame(screen, glyphs, scan_animation);
 
-		animPreviousTime = currentTime;
+		// the idle path is expected to stay off the heap.
+		animAllocs += allocCount() - allocs;
+		governor.drawn(micros());
 	}
 }
 
 
 /**
- * Connect the board to a Wi-Fi network.
+ * Start associating with the Wi-Fi network.
  * 
  * The board is fixed to a specific SSID and PASS.
- * The scanning process will not stop until it 
- * successfully connects to this specific network.
+ * WiFi.begin() returns immediately, the association runs in the
+ * background while the LCD and the scanner are brought up.
 */
-void connectToWiFi() {
-    Serial.print("\n[i] Connecting to Wi-Fi");
-    displayText("  Client Start  ", "   conn WiFi   ");
+void beginWiFi() {
+    LOG_INFO("\n[i] Connecting to Wi-Fi");
+    WiFi.persistent(false);
+    WiFi.mode(WIFI_STA);
     WiFi.begin(WIFI_SSID, WIFI_PASS);
+}
+
 
-    while (WiFi.status() != WL_CONNECTED) {
-        delay(1000);
-        Serial.print(".");
+/**
+ * Check the association started by beginWiFi(), printing a dot
+ * every second while it is pending.
+ * 
+ * setup() keeps polling until it successfully
+ * connects to this specific network.
+ * @return true once connected.
+*/
+bool checkWiFi() {
+    static unsigned long dotTime = millis();
+    if (WiFi.status() != WL_CONNECTED) {
+        if (millis() - dotTime >= 1000) {
+            LOG_INFO(".");
+            dotTime = millis();
+        }
+        return false;
     }
 
-    Serial.print("\n[i] Connected to ");
-    Serial.print(WiFi.localIP());
-    displayText("  Client Start  ", "   conn WiFi.   ");
+    LOG_INFO("\n[i] Connected to ");
+    LOG_INFO(WiFi.localIP());
+    displayText(TEXT_CONN_WIFI_OK);
+    return true;
 }
 
 
 /**
- * Connect the board to a server as a client.
+ * Try once to connect the board to a server as a client.
  * 
  * The client object is a socket that will try to 
  * find a server program on a specific address.
+ * @return true once connected.
 */
-void connectToServer() {
-    Serial.print("\n[i] Connecting to Server");
-    displayText("  Client Start  ", "  conn Server   ");
-
-    while (!client.connect(HOST, PORT)) {
-        delay(1000);
-        Serial.print(".");
+bool connectToServer() {
+    if (!client.connect(HOST, PORT)) {
+        LOG_INFO(".");
+        return false;
     }
 
-    Serial.print("\n[i] Connected !");
+    LOG_INFO("\n[i] Connected !");
     is_connected = true;
 	client.println(CLIENT_ID);
     client.print("Client connected successfully. // Hello Server // \n");
-    displayText("  Client Start  ", "  conn Server.   ");
+    displayText(TEXT_CONN_SERVER_OK);
+    return true;
 }
 
 
@@ -216,201 +499,133 @@ void disconnectFromServer() {
     if (is_connected) {
         client.print("disconnect\n");
         client.flush();
-        Serial.print("\n[i] Disconnecting...");
+        LOG_INFO("\n[i] Disconnecting...");
         client.stop();
         is_connected = false;
-        Serial.print("\n[i] Disconnected from server !");
-        displayText("  Disconnected  ", "  please reset  ");
+        debug_log.route(Serial);
+        LOG_INFO("\n[i] Disconnected from server !");
+        displayText(TEXT_DISCONNECTED);
     }
 }
 
 
 /**
- * Enroll a fingerprint
+ * Log a getImage() result while enrolling.
 */
-bool getFingerprintEnroll(uint8_t id) {
-	Serial.print("Waiting for valid finger to enroll as #");
-	Serial.println(id);
-
-	int p = -1;
-	enrollPrevousTime = 0;
-	while (p != FINGERPRINT_OK) {
-		currentTime = millis();
-		scanAnimation();
-
-		if (currentTime - enrollPrevousTime >= animInterval) {
-			p = finger_scanner.getImage();
-			switch (p) {
-				case FINGERPRINT_OK:
-					Serial.println("Image taken");
-					displayText("  Image  Taken  ", " please wait... ");
-					break;
-				case FINGERPRINT_NOFINGER:
-					Serial.println(".");
-					break;
-				case FINGERPRINT_PACKETRECIEVEERR:
-					Serial.println("Communication error");
-					break;
-				case FINGERPRINT_IMAGEFAIL:
-					Serial.println("Imaging error");
-					break;
-				default:
-					Serial.println("Unknown error");
-					break;
-			}
-
-			enrollPrevousTime = currentTime;
-		}
-	}
-
-	// OK success!
-	displayText("   Processing   ", "    Image...    ");
-	p = finger_scanner.image2Tz(1);
+void printImageResult(uint8_t p) {
 	switch (p) {
 		case FINGERPRINT_OK:
-			Serial.println("Image converted");
-			delay(100);
+			LOG_DEBUGLN("Image taken");
+			displayText(TEXT_IMAGE_TAKEN);
+			break;
+		case FINGERPRINT_NOFINGER:
+			LOG_DEBUGLN(".");
 			break;
-		case FINGERPRINT_IMAGEMESS:
-			Serial.println("Image too messy");
-			return 0;
 		case FINGERPRINT_PACKETRECIEVEERR:
-			Serial.println("Communication error");
-			return 0;
-		case FINGERPRINT_FEATUREFAIL:
-			Serial.println("Could not find fingerprint features");
-			return 0;
-		case FINGERPRINT_INVALIDIMAGE:
-			Serial.println("Could not find fingerprint features");
-			return 0;
+			LOG_ERRORLN("Communication error");
+			break;
+		case FINGERPRINT_IMAGEFAIL:
+			LOG_ERRORLN("Imaging error");
+			break;
 		default:
-			Serial.println("Unknown error");
-			return 0;
-	}
-
-
-	Serial.println("Remove finger");
-	displayText("      ----      ", " Remove Finger  ");
-
-	p = 0;
-	enrollPrevousTime = 0;
-	while (p != FINGERPRINT_NOFINGER) {
-		currentTime = millis();
-		if (currentTime - enrollPrevousTime >= 2000) {
-			p = finger_scanner.getImage();
-			enrollPrevousTime = currentTime;
-		}
+			LOG_ERRORLN("Unknown error");
+			break;
 	}
+}
 
-	Serial.print("ID "); Serial.println(id);
-	p = -1;
-	enrollPrevousTime = 0;
-	Serial.println("Place same finger again");
-	displayText("   Place Same   ", "  Finger again  ");
-	while (p != FINGERPRINT_OK) {
-		currentTime = millis();
-		if (currentTime - enrollPrevousTime >= animInterval) {
-			p = finger_scanner.getImage();
-			enrollPrevousTime = currentTime;
-		}
-
-
-		switch (p) {
-			case FINGERPRINT_OK:
-				Serial.println("Image taken");
-				displayText("  Image  Taken  ", " please wait... ");
-				break;
-			case FINGERPRINT_NOFINGER:
-				Serial.print(".");
-				break;
-			case FINGERPRINT_PACKETRECIEVEERR:
-				Serial.println("Communication error");
-				break;
-			case FINGERPRINT_IMAGEFAIL:
-				Serial.println("Imaging error");
-				break;
-			default:
-				Serial.println("Unknown error");
-				break;
-		}
 
-		enrollPrevousTime = currentTime;
+/**
+ * Turn the image just taken into features in a template slot.
+ * @return true if converted.
+*/
+bool convertImage(uint8_t slot) {
+	uint8_t p;
+	{
+		CpuBoost boost(BOOST_CONVERT);
+		p = finger_scanner.image2Tz(slot);
 	}
-
-
-	// OK success!
-	displayText("   Processing   ", "    Image...    ");
-	p = finger_scanner.image2Tz(2);
 	switch (p) {
 		case FINGERPRINT_OK:
-			Serial.println("Image converted");
-			delay(100);
-			break;
+			LOG_DEBUGLN("Image converted");
+			return 1;
 		case FINGERPRINT_IMAGEMESS:
-			Serial.println("Image too messy");
+			LOG_ERRORLN("Image too messy");
 			return 0;
 		case FINGERPRINT_PACKETRECIEVEERR:
-			Serial.println("Communication error");
+			LOG_ERRORLN("Communication error");
 			return 0;
 		case FINGERPRINT_FEATUREFAIL:
-			Serial.println("Could not find fingerprint features");
+			LOG_ERRORLN("Could not find fingerprint features");
 			return 0;
 		case FINGERPRINT_INVALIDIMAGE:
-			Serial.println("Could not find fingerprint features");
+			LOG_ERRORLN("Could not find fingerprint features");
 			return 0;
 		default:
-			Serial.println("Unknown error");
+			LOG_ERRORLN("Unknown error");
 			return 0;
 	}
+}
 
-	// OK converted!
-	Serial.print("Creating model for #");  
-	Serial.println(id);
 
-	p = finger_scanner.createModel();
+/**
+ * Build the model from both templates and store it as id.
+ * @return true if stored.
+*/
+bool storeEnrollment(uint16_t id) {
+	LOG_DEBUG("Creating model for #");  
+	LOG_DEBUGLN(id);
+
+	uint8_t p;
+	{
+		CpuBoost boost(BOOST_MODEL);
+		p = finger_scanner.createModel();
+	}
 	if (p == FINGERPRINT_OK) {
-		Serial.println("Prints matched!");
-		displayText("  Fingerprints  ", "    Matched     ");
+		LOG_DEBUGLN("Prints matched!");
+		displayText(TEXT_PRINTS_MATCHED);
 	} 
 	else if (p == FINGERPRINT_PACKETRECIEVEERR) {
-		Serial.println("Communication error");
-		displayText(" Communication  ", "     Error      ");
+		LOG_ERRORLN("Communication error");
+		displayText(TEXT_COMM_ERROR);
 		return 0;
 	} 
 	else if (p == FINGERPRINT_ENROLLMISMATCH) {
-		Serial.println("Fingerprints did not match");
-		displayText("  Fingerprints  ", " Did Not Match  ");
+		LOG_ERRORLN("Fingerprints did not match");
+		displayText(TEXT_PRINTS_MISMATCH);
 		return 0;
 	} 
 	else {
-		Serial.println("Unknown error");
-		displayText("    Unknown     ", "     Error      ");
+		LOG_ERRORLN("Unknown error");
+		displayText(TEXT_UNKNOWN_ERROR);
 		return 0;
 	}
 
 
-	Serial.print("ID "); 
-	Serial.println(id);
-	p = finger_scanner.storeModel(id);
+	LOG_DEBUG("ID "); 
+	LOG_DEBUGLN(id);
+	{
+		CpuBoost boost(BOOST_MODEL);
+		p = finger_scanner.storeModel(id);
+	}
 	if (p == FINGERPRINT_OK) {
-		Serial.println("Stored to internal database");
-		displayText("  Sending Data  ", "  to Database   ");
-		delay(1000);
+		LOG_DEBUGLN("Stored to internal database");
+		displayProgress(TEXT_SENDING_DATA, ENROLL_STEPS, ENROLL_STEPS);
 	} 
 	else if (p == FINGERPRINT_PACKETRECIEVEERR) {
-		Serial.println("Communication error");
+		LOG_ERRORLN("Communication error");
 		return 0;
 	} 
 	else if (p == FINGERPRINT_BADLOCATION) {
-		Serial.println("Could not store in that location");
+		LOG_ERRORLN("Could not store in that location");
+		checkSlotRejected(id);
 		return 0;
 	} 
 	else if (p == FINGERPRINT_FLASHERR) {
-		Serial.println("Error writing to flash");
+		LOG_ERRORLN("Error writing to flash");
 		return 0;
 	} 
 	else {
-		Serial.println("Unknown error");
+		LOG_ERRORLN("Unknown error");
 		return 0;
 	}
 
@@ -429,6 +644,36 @@ void sendFinger() {
 }
 
 
+/**
+ * Go idle, see idle_mode.h. The modem still wakes for every DTIM
+ * beacon, so the server link stays up.
+*/
+void enterIdle() {
+	LOG_INFO("\n[i] Idle.");
+	WiFi.setSleepMode(WIFI_MODEM_SLEEP, 0);
+	lcd.noBacklight();
+	scheduler.setPeriod(sensor_task, IDLE_POLL_INTERVAL);
+	idle.enter(millis());
+}
+
+
+/**
+ * Note activity, back to full power first if the unit is idle.
+ * @param stamp micros() of the event behind it.
+*/
+void wakeUp(WakeCause cause, unsigned long stamp) {
+	unsigned long now = millis();
+	if (idle.idle()) {
+		WiFi.setSleepMode(WIFI_NONE_SLEEP);
+		lcd.backlight();
+		scheduler.setPeriod(sensor_task, SENSOR_POLL_INTERVAL);
+		idle.leave(now, cause, stamp);
+		LOG_INFO("\n[i] Awake.");
+	}
+	idle.activity(now);
+}
+
+
 /**
  * Scan a fingerprint and match it on the database.
 */
@@ -436,286 +681,946 @@ int getFingerprintID() {
 	uint8_t p = finger_scanner.getImage();
 	switch (p) {
 		case FINGERPRINT_OK:
-			Serial.println("Image taken");
-			displayText("  Image  Taken  ", " please wait... ");
+			// the finger that produced the last result is still resting.
+			if (!fingerLifted) {
+				return -1;
+			}
+			scanImageTime = millis();
+			// a touch only counts as a wake once the image proves a finger.
+			if (touchPending) {
+				touchPending = false;
+				wakeUp(WAKE_TOUCH, touchStamp);
+			}
+			idle.scanned(micros());
+			wakeUp(WAKE_SCAN, micros());
+			LOG_DEBUGLN("Image taken");
+			screens.preempt(SCREEN_INFO);
+			displayText(TEXT_IMAGE_TAKEN);
 			break;
 		case FINGERPRINT_NOFINGER:
-			Serial.println("No Finger detected");
+			fingerLifted = true;
+			touchPending = false;
+			LOG_DEBUGLN("No Finger detected");
 			return -1;
 		case FINGERPRINT_PACKETRECIEVEERR:
-			Serial.println("Communication error");
+			LOG_ERRORLN("Communication error");
 			return -1;
 		case FINGERPRINT_IMAGEFAIL:
-			Serial.println("Imaging error");
+			LOG_ERRORLN("Imaging error");
 			return -1;
 		default:
-			Serial.println("Unknown error");
+			LOG_ERRORLN("Unknown error");
 			return -1;
 	}
 
 
 	// OK success!
-	p = finger_scanner.image2Tz();
-	displayText("   Processing   ", "    Image...    ");
+	{
+		CpuBoost boost(BOOST_CONVERT);
+		p = finger_scanner.image2Tz();
+	}
+	displayText(TEXT_PROCESSING);
 	switch (p) {
 		case FINGERPRINT_OK:
-			Serial.println("Image converted");
-			delay(100);
+			LOG_DEBUGLN("Image converted");
 			break;
 		case FINGERPRINT_IMAGEMESS:
-			Serial.println("Image too messy");
+			LOG_ERRORLN("Image too messy");
 			return -1;
 		case FINGERPRINT_PACKETRECIEVEERR:
-			Serial.println("Communication error");
+			LOG_ERRORLN("Communication error");
 			return -1;
 		case FINGERPRINT_FEATUREFAIL:
-			Serial.println("Could not find fingerprint features");
+			LOG_ERRORLN("Could not find fingerprint features");
 			return -1;
 		case FINGERPRINT_INVALIDIMAGE:
-			Serial.println("Could not find fingerprint features");
+			LOG_ERRORLN("Could not find fingerprint features");
 			return -1;
 		default:
-			Serial.println("Unknown error");
+			LOG_ERRORLN("Unknown error");
 			return -1;
 	}
 
 
 	// OK converted!
-	p = finger_scanner.fingerSearch();
+	{
+		CpuBoost boost(BOOST_SEARCH);
+		p = finger_scanner.fingerSearch();
+	}
 	if (p == FINGERPRINT_OK) {
-		Serial.println("Found a print match!");
-		displayText("  Fingerprint   ", "    is found    ");
-		delay(1000);
+		// the dwell for this screen is served by scanFinger() while the
+		// server handles the attendance, see foundDwell.
+		LOG_DEBUGLN("Found a print match!");
+		displayText(TEXT_FOUND);
+		fingerLifted = false;
 	} 
 	else if (p == FINGERPRINT_PACKETRECIEVEERR) {
-		Serial.println("Communication error");
+		LOG_ERRORLN("Communication error");
 		return -1;
 	} 
 	else if (p == FINGERPRINT_NOTFOUND) {
-		Serial.println("Did not find a match");
-		displayText("  Did not Find  ", "     Match      ");
-		delay(1000);
+		LOG_DEBUGLN("Did not find a match");
+		screens.push(TEXT_NOT_FOUND, 1000, SCREEN_INFO);
+		fingerLifted = false;
 		return -1;
 	} 
 	else {
-		Serial.println("Unknown error");
+		LOG_ERRORLN("Unknown error");
 		return -1;
 	}
 
 	// found a match!
-	Serial.print("Found ID #"); Serial.print(finger_scanner.fingerID);
-	Serial.print(" with confidence of "); Serial.println(finger_scanner.confidence);
+	LOG_DEBUG("Found ID #"); LOG_DEBUG(finger_scanner.fingerID);
+	LOG_DEBUG(" with confidence of "); LOG_DEBUGLN(finger_scanner.confidence);
 
 	return finger_scanner.fingerID;
 }
 
 
- 
-void enrollFinger() {
-    scan_mode = 0x01;
-    Serial.print("\n[i] Ready to enroll a fingerprint.");
-    displayText("   Enrollment   ", "      Mode      ");
-    String finger_id_unparsed = client.readStringUntil('\n');
-    String first_name = client.readStringUntil('\n');
-    String middle_name = client.readStringUntil('\n');
-    String last_name = client.readStringUntil('\n');
-    String age = client.readStringUntil('\n');
-    String gender = client.readStringUntil('\n');
-    String phone_number = client.readStringUntil('\n');
-    String address = client.readStringUntil('\n');
-
-    client.println("enrollFinger");
-    uint8_t id = finger_id_unparsed.toInt();
-    while (!getFingerprintEnroll(id));
-
-    client.println(first_name);
-    delay(30);
-    client.println(middle_name);
-    delay(30);
-    client.println(last_name);
-    delay(30);
-    client.println(age);
-    delay(30);
-    client.println(gender);
-    delay(30);
-    client.println(phone_number);
-    delay(30);
-    client.println(address);
-    delay(30);
-    client.println(id);
-
-    displayText(" Waiting for  ", "  Feedback...   ");
-    String feedback = client.readStringUntil('\n');
-    if (feedback == "OK") {
-      	displayText("   Enrollment   ", "    Success!    ");
-    }
-    else {
-      	displayText("  Enroll Fail!  ", "   Try  Again   ");
-    }
-    delay(2000);
-}
-
-
-void scanFinger() {
-	if (currentTime - loginPreviousTime >= animInterval) {
-
-		scan_mode = 0x00;
-		int fingerprint_id = getFingerprintID();
-		if (fingerprint_id != -1) {
-			client.println("scanFinger");
-			client.println(fingerprint_id);
-			displayText("    Logging     ", "   Attendance   ");
-			// TODO: to be logged into database, get feedback.
-			String feedback = client.readStringUntil('\n');
-			if (feedback == "OK") {
-				displayText("  Successfully  ", "  Logged to DB  ");
-				String attendee_first_name = client.readStringUntil('\n');
-				delay(2000);
-				displayText("                ", "                ");
-				displayText("Welcome:        ", attendee_first_name);
+/**
+ * Ask the server connection for the next line, see CO_AWAIT_LINE().
+*/
+void requestLine(Coroutine &co) {
+	talkWantsLine = true;
+	talkLineReady = false;
+	co.timer = millis();
+}
+
+
+bool lineArrived(const Coroutine &co, unsigned long timeout) {
+	return talkLineReady || millis() - co.timer >= timeout;
+}
+
+
+/**
+ * Copy the requested line, empty if it did not come in time.
+ * @return false if it was longer than the field, it is cut to fit.
+*/
+bool takeLine(char *dest, size_t size) {
+	bool fits = true;
+	if (talkLineReady) {
+		fits = strlen(talkLine) < size;
+		strncpy(dest, talkLine, size - 1);
+		dest[size - 1] = '\0';
+	}
+	else {
+		dest[0] = '\0';
+	}
+	talkWantsLine = false;
+	talkLineReady = false;
+	return fits;
+}
+
+
+/**
+ * Parse a fingerprint id, decimal digits only.
+ * @return false if the text is empty, not a number or above 65535.
+*/
+bool parseId(const char *text, uint16_t &id) {
+	if (*text == '\0') {
+		return false;
+	}
+
+	uint32_t value = 0;
+	for (; *text; text++) {
+		if (*text < '0' || *text > '9') {
+			return false;
+		}
+		value = value * 10 + (*text - '0');
+		if (value > 0xFFFF) {
+			return false;
+		}
+	}
+	id = value;
+	return true;
+}
+
+
+char *enrollField(EnrollContext &c, uint8_t field) {
+	return (char *)&c.fields + enroll_layout[field].offset;
+}
+
+
+/**
+ * @return true once the enrollment has used up ENROLL_BUDGET, the
+ * overrun is logged with the watchdog the first time.
+*/
+bool enrollExpired() {
+	EnrollContext &c = enroll_talk;
+	unsigned long elapsed = millis() - c.started;
+	if (elapsed < ENROLL_BUDGET) {
+		return false;
+	}
+	if (!c.reported) {
+		c.reported = true;
+		watchdog.overrun("enroll", ENROLL_BUDGET, elapsed);
+	}
+	return true;
+}
+
+
+/**
+ * Enroll a fingerprint for the server.
+ *
+ * Takes the id and the details sent after "enroll", has the finger
+ * placed twice, stores the model, then passes the details on and shows
+ * the server's answer. Failed steps start over until the budget is spent.
+*/
+int enrollFinger() {
+	EnrollContext &c = enroll_talk;
+	CO_BEGIN(c.co);
+	scan_animation.mode = SCAN_ENROLL;
+	LOG_INFO("\n[i] Ready to enroll a fingerprint.");
+	displayText(TEXT_ENROLL_MODE);
+
+	c.field_too_long = false;
+	for (c.field = 0; c.field < ENROLL_FIELDS; c.field++) {
+		CO_AWAIT_LINE(c.co, LINE_TIMEOUT);
+		if (!takeLine(enrollField(c, c.field), enroll_layout[c.field].size)) {
+			c.field_too_long = true;
+		}
+	}
+
+	// a cut name would be stored wrong, refuse it like a bad id.
+	if (c.field_too_long) {
+		LOG_ERROR("\n[i] Enroll field too long.");
+		screens.push(TEXT_ENROLL_FAIL, 2000, SCREEN_RESULT);
+		CO_EXIT(c.co);
+	}
+
+	if (!parseId(c.fields.id, c.id) || c.id == 0 || c.id >= sensor_profile.capacity) {
+		LOG_ERROR("\n[i] Enroll id out of range.");
+		screens.push(TEXT_ENROLL_FAIL, 2000, SCREEN_RESULT);
+		CO_EXIT(c.co);
+	}
+
+	// retried until it works, or given up once the budget is spent.
+	c.enrolled = false;
+	c.reported = false;
+	c.started = millis();
+	while (!c.enrolled && !enrollExpired()) {
+		LOG_DEBUG("Waiting for valid finger to enroll as #");
+		LOG_DEBUGLN(c.id);
+
+		// the display task animates while nothing else is shown.
+		screenHeld = false;
+		for (;;) {
+			c.p = finger_scanner.getImage();
+			printImageResult(c.p);
+			if (c.p == FINGERPRINT_OK || enrollExpired()) {
+				break;
+			}
+			CO_SLEEP(c.co, SENSOR_POLL_INTERVAL);
+		}
+		screenHeld = true;
+		if (c.p != FINGERPRINT_OK) {
+			break;
+		}
+
+		displayProgress(TEXT_PROCESSING, 1, ENROLL_STEPS);
+		if (!convertImage(1)) {
+			continue;
+		}
+
+		LOG_DEBUGLN("Remove finger");
+		displayText(TEXT_REMOVE_FINGER);
+		for (;;) {
+			c.p = finger_scanner.getImage();
+			if (c.p == FINGERPRINT_NOFINGER || enrollExpired()) {
+				break;
 			}
-			else {
-				displayText(" Failed logging ", "   Attendance   ");
+			CO_SLEEP(c.co, REMOVE_POLL_INTERVAL);
+		}
+		if (c.p != FINGERPRINT_NOFINGER) {
+			break;
+		}
+
+		LOG_DEBUG("ID "); LOG_DEBUGLN(c.id);
+		LOG_DEBUGLN("Place same finger again");
+		displayText(TEXT_PLACE_AGAIN);
+		for (;;) {
+			c.p = finger_scanner.getImage();
+			printImageResult(c.p);
+			if (c.p == FINGERPRINT_OK || enrollExpired()) {
+				break;
 			}
-			delay(3000);
+			CO_SLEEP(c.co, SENSOR_POLL_INTERVAL);
+		}
+		if (c.p != FINGERPRINT_OK) {
+			break;
 		}
-		loginPreviousTime = currentTime;
 
+		displayProgress(TEXT_PROCESSING, 3, ENROLL_STEPS);
+		if (!convertImage(2)) {
+			continue;
+		}
+		c.enrolled = storeEnrollment(c.id);
+	}
+
+	if (!c.enrolled) {
+		LOG_ERROR("\n[i] Enrollment timed out.");
+		screens.push(TEXT_ENROLL_FAIL, 2000, SCREEN_RESULT);
+		CO_EXIT(c.co);
+	}
+
+	// the outbox task sends these one per OUTBOX_INTERVAL. The protocol
+	// has no failure reply, so "enrollFinger" only goes out with a stored
+	// template and a failed enrollment leaves the server nothing to read.
+	outbox.push("enrollFinger");
+	for (c.field = 1; c.field < ENROLL_FIELDS; c.field++) {
+		outbox.push(enrollField(c, c.field));
+	}
+	outbox.push((long)c.id);
+
+	displayText(TEXT_ENROLL_WAIT);
+	CO_AWAIT_LINE(c.co, ENROLL_REPLY_TIMEOUT);
+	takeLine(c.reply, sizeof(c.reply));
+	if (strcmp(c.reply, "OK") == 0) {
+		screens.push(TEXT_ENROLL_OK, 2000, SCREEN_RESULT);
 	}
+	else {
+		screens.push(TEXT_ENROLL_FAIL, 2000, SCREEN_RESULT);
+	}
+	CO_END(c.co);
 }
 
 
-uint8_t deleteFingerprint(uint8_t id) {
+/**
+ * Submit a matched fingerprint and show the server's answer.
+ * "is found" stays up while the server works.
+*/
+int scanFinger() {
+	ScanContext &c = scan_talk;
+	CO_BEGIN(c.co);
+	c.matched = millis();
+	client.println("scanFinger");
+	client.println(c.id);
+	CO_AWAIT_LINE(c.co, LINE_TIMEOUT);
+	takeLine(c.reply, sizeof(c.reply));
+
+	{
+		unsigned long serverTime = millis() - c.matched;
+		c.dwell = 0;
+		if (serverTime < foundDwell) {
+			c.dwell = foundDwell - serverTime;
+		}
+
+		LOG_DEBUG("\n[i] scan match(ms) ");
+		LOG_DEBUG(c.matched - scanImageTime);
+		LOG_DEBUG(" server(ms) ");
+		LOG_DEBUG(serverTime);
+		LOG_DEBUG(" dwell(ms) ");
+		LOG_DEBUGLN(c.dwell);
+	}
+
+	// screens are pushed last first: found, logged, then welcome.
+	if (strcmp(c.reply, "OK") == 0) {
+		CO_AWAIT_LINE(c.co, LINE_TIMEOUT);
+		takeLine(c.name, sizeof(c.name));
+		screens.push(TEXT_WELCOME, 3000, SCREEN_INFO, c.name);
+		screens.push(TEXT_LOGGED, 2000, SCREEN_INFO);
+	}
+	else {
+		screens.push(TEXT_LOG_FAILED, 3000, SCREEN_INFO);
+	}
+	screens.push(TEXT_FOUND, c.dwell, SCREEN_INFO);
+	CO_END(c.co);
+}
+
+
+uint8_t deleteFingerprint(uint16_t id) {
 	uint8_t p = -1;
 	boolean deleteSuccess = false;
 
 	p = finger_scanner.deleteModel(id);
 
 	if (p == FINGERPRINT_OK) {
-		Serial.println("Deleted!");
+		LOG_DEBUGLN("Deleted!");
 		deleteSuccess = true;
 	} 
 	else if (p == FINGERPRINT_PACKETRECIEVEERR) {
-		Serial.println("Communication error");
+		LOG_ERRORLN("Communication error");
 	} 
 	else if (p == FINGERPRINT_BADLOCATION) {
-		Serial.println("Could not delete in that location");
+		LOG_ERRORLN("Could not delete in that location");
+		checkSlotRejected(id);
 	} 
 	else if (p == FINGERPRINT_FLASHERR) {
-		Serial.println("Error writing to flash");
+		LOG_ERRORLN("Error writing to flash");
 	} 
 	else {
-		Serial.print("Unknown error: 0x"); Serial.println(p, HEX);
+		LOG_ERROR("Unknown error: 0x"); LOG_ERRORLN(p, HEX);
 	}
 
 
 	if (!deleteSuccess) {
-		displayText("     Delete     ", "      Fail!     ");
+		screens.push(TEXT_DELETE_FAIL, 2000, SCREEN_RESULT);
 		client.println("deleteFingerFail");
 		return p;
 	}
 
-	displayText("     Delete     ", "    Success!    ");
+	screens.push(TEXT_DELETE_OK, 2000, SCREEN_RESULT);
 	client.println("deleteFingerOk");
 	return p;
 }
 
 
-void deleteUser() {
-	String fingerprint_id_unparsed = client.readStringUntil('\n');
-	uint8_t fingerprint_id = fingerprint_id_unparsed.toInt();
-	Serial.println(fingerprint_id_unparsed);
+/**
+ * Delete the fingerprint whose id follows the "delete" command.
+*/
+int deleteUser() {
+	DeleteContext &c = delete_talk;
+	CO_BEGIN(c.co);
+	CO_AWAIT_LINE(c.co, LINE_TIMEOUT);
+	takeLine(c.text, sizeof(c.text));
+	LOG_DEBUGLN(c.text);
+
+	if (!parseId(c.text, c.id)) {
+		LOG_ERROR("\n[i] Bad delete id.");
+		screens.push(TEXT_DELETE_FAIL, 2000, SCREEN_RESULT);
+		client.println("deleteFingerFail");
+		CO_EXIT(c.co);
+	}
+	deleteFingerprint(c.id);
+	CO_END(c.co);
+}
+
 
-	deleteFingerprint(fingerprint_id);
+/**
+ * Start a conversation, conversationTask() runs it from the next pass.
+*/
+void startTalk(Talk which, Coroutine &co) {
+	// a queued beat must reach the server before the conversation's
+	// lines, heartbeatTask() queues no more until it ends.
+	if (is_connected) {
+		outbox.flush(client);
+	}
+	talk = which;
+	screenHeld = true;
+	startCoroutine(co);
+}
+
+
+void printCoroutines(Print &out) {
+	printCoroutine(out, "enroll", enroll_talk.co, sizeof(enroll_talk));
+	printCoroutine(out, "scan", scan_talk.co, sizeof(scan_talk));
+	printCoroutine(out, "delete", delete_talk.co, sizeof(delete_talk));
+	out.print("lines truncated=");
+	out.print(server_lines.truncated);
+	out.print("\n");
+}
+
+
+void markBoot(BootStage stage) {
+    bootStamps[stage] = millis();
 }
 
 
 /**
- * Initialize all connections.
+ * Print the boot timeline, milliseconds since reset for each stage.
 */
-void setup() {
-    Serial.begin(115200);
-    Serial.print("\n[i] Starting Client...");
+void reportBoot(Print &out) {
+    out.print("boot");
+    for (int i = 0; i < BOOT_STAGES; i++) {
+        out.print(" ");
+        out.print(bootStageNames[i]);
+        out.print("=");
+        out.print(bootStamps[i]);
+    }
+    out.print("\n");
+}
 
-    delay(50);
-    initFingerprintScanner();
-    delay(50);
-    initLCD();
-    delay(50);
-    connectToWiFi();
-    delay(50);
-    connectToServer();
-    delay(50);
 
-    lcd.setCursor(0, 0);
-    lcd.print("  Scan  Finger  ");
-    delay(2);
+/**
+ * Send the heartbeat, the server drops clients that stay silent.
+*/
+void heartbeatTask() {
+	// the server reads a conversation's lines in order, a beat would
+	// be taken for one of them.
+	if (talk != TALK_NONE) {
+		return;
+	}
+	if (!beatTelemetry) {
+		outbox.push("beat");
+		return;
+	}
+
+	// "beat free=.. block=.. frag=.. min=.. stack=..", only for a server
+	// that asked with beatTelemetryOn and so matches "beat" as a prefix.
+	char line[OUTBOX_LINE_SIZE];
+	memcpy(line, "beat ", 5);
+	heap.format(heap.measure(millis()), line + 5, sizeof(line) - 5);
+	outbox.push(line);
 }
 
 
 /**
- * The Main event loop. will listen for events and execute 
- * functions related to events. 
+ * Keep a heap sample for the history, see heap_telemetry.h.
 */
-void loop() {
-	currentTime = millis();
-    
+void telemetryTask() {
+	heap.sample(millis());
+}
 
-	// heartbeat mechanism
-	if (currentTime - beatPreviousTime >= heartbeatInterval) {
-		client.println("beat");
-		beatPreviousTime = currentTime;
+
+/**
+ * Send one queued line to the server, see line_outbox.h.
+*/
+void outboxTask() {
+	if (is_connected) {
+		outbox.sendNext(client);
 	}
+}
 
 
-    // check if there is available data to be read.
-    if (client.available()) {
-        message = client.readStringUntil('\n');
+/**
+ * Restart the board, scheduled by the reboot command so the
+ * "Rebooting..." screen and the disconnect get out first.
+*/
+void rebootTask() {
+	ESP.restart();
+}
 
-        if (message == "disconnect") {
-            disconnectFromServer();
-        }
 
-        else if (message == "reboot") {
-            disconnectFromServer();
-            WiFi.disconnect();
-            delay(50);
-            displayText("      ----      ", "  Rebooting...  ");
-            delay(1000);
-            ESP.restart();
-        }
+/**
+ * Print the heap allocations made for server lines. Reading and routing
+ * should make none, a command's own sends may allocate in the TCP stack.
+*/
+void printProtocolAllocs(Print &out) {
+	out.print("protocol lines=");
+	out.print(protocol_lines);
+	out.print(" rxAllocs=");
+	out.print(protocol_allocs);
+	out.print(" cmdAllocs=");
+	out.print(command_allocs);
+	out.print("\n");
+}
 
-        else if (message == "enroll") {
-            enrollFinger();
-        }
 
-		else if (message == "heartbeat") {
-			responseTime = millis();
-			Serial.print("\nserver rt(ms) ");
-			Serial.println(responseTime - currentTime);
-		}
+/**
+ * Log lines routed to the server only go out between exchanges, never
+ * in the middle of a conversation or ahead of queued protocol lines.
+*/
+bool serverLogGate() {
+	return talk == TALK_NONE && outbox.empty();
+}
 
-		else if (message == "delete") {
-			deleteUser();
-			delay(2000);
-		}
 
-		else if (message == "deleteAllDataFromDatabase") {
-			finger_scanner.emptyDatabase();
-			displayText("  ALL DATA IS   ", "    DELETED!    ");
-			client.println("deleteAllDataFromDatabase");
-			delay(2000);
-		}
+/**
+ * Execute one server command.
+*/
+void runCommand(const char *message) {
+    if (strcmp(message, "heartbeat") == 0) {
+		LOG_DEBUG("\nserver rt(ms) ");
+		LOG_DEBUGLN(millis() - currentTime);
+	}
 
-		
-		// reset heartbeat
-		currentTime = millis();
-		beatPreviousTime = currentTime;
+    else if (strcmp(message, "disconnect") == 0) {
+        disconnectFromServer();
     }
-    
-    // check if the client is still connected to a server before scanning finger.
-    if (is_connected) {
-		scanFinger();
+
+    else if (strcmp(message, "reboot") == 0) {
+        disconnectFromServer();
+        WiFi.disconnect();
+        displayText(TEXT_REBOOTING);
+        scheduler.add("reboot", rebootTask, REBOOT_DELAY, REBOOT_DELAY, millis());
+    }
+
+    else if (strcmp(message, "enroll") == 0) {
+        startTalk(TALK_ENROLL, enroll_talk.co);
+    }
+
+	else if (strcmp(message, "delete") == 0) {
+		startTalk(TALK_DELETE, delete_talk.co);
+	}
+
+	else if (strcmp(message, "trace") == 0) {
+		finger_trace.dump(Serial);
+		finger_trace.dump(client);
+		client.println("traceEnd");
+	}
+
+	else if (strcmp(message, "traceReset") == 0) {
+		finger_trace.clear();
+	}
+
+	else if (strcmp(message, "sensorProbe") == 0) {
+		probeFingerprintScanner();
+		printSensorProfile(Serial, sensor_profile);
+		printSensorProfile(client, sensor_profile);
+	}
+
+	else if (strcmp(message, "lcdBench") == 0) {
+		benchLCD(Serial);
+		benchLCD(client);
+	}
+
+	else if (strcmp(message, "lcdStats") == 0) {
+		screen.printStats(Serial);
+		screen.printStats(client);
+		glyphs.printStats(Serial);
+		glyphs.printStats(client);
+		governor.printStats(Serial);
+		governor.printStats(client);
+		printAnimAllocs(Serial);
+		printAnimAllocs(client);
+		screen.resetStats();
+		governor.resetStats();
+		animAllocs = 0;
+	}
+
+	else if (strcmp(message, "taskStats") == 0) {
+		scheduler.printStats(Serial);
+		scheduler.printStats(client);
+		scheduler.resetStats();
+	}
+
+	else if (strcmp(message, "transport") == 0) {
+		client.printStats(Serial);
+		client.printStats(client);
+		client.resetStats();
+	}
+
+	else if (strcmp(message, "watchdog") == 0) {
+		watchdog.printStats(Serial);
+		watchdog.printStats(client);
+		watchdog.resetStats();
+	}
+
+	else if (strcmp(message, "coroutines") == 0) {
+		printCoroutines(Serial);
+		printCoroutines(client);
+	}
+
+	else if (strcmp(message, "events") == 0) {
+		events.printStats(Serial);
+		events.printStats(client);
+	}
+
+	else if (strcmp(message, "idle") == 0) {
+		idle.printStats(Serial, millis());
+		idle.printStats(client, millis());
+		idle.resetStats(millis());
+	}
+
+	else if (strcmp(message, "boost") == 0) {
+		printCpuBoostStats(Serial);
+		printCpuBoostStats(client);
+		resetCpuBoostStats();
+	}
+
+	else if (strcmp(message, "boostOn") == 0) {
+		setCpuBoost(true);
+	}
+
+	else if (strcmp(message, "boostOff") == 0) {
+		setCpuBoost(false);
+	}
+
+	else if (strcmp(message, "log") == 0) {
+		debug_log.printStats(Serial);
+		debug_log.printStats(client);
+		debug_log.resetStats();
+	}
+
+	else if (strcmp(message, "logToServer") == 0) {
+		// "log <text>" lines, the server skips them when reading replies.
+		debug_log.route(client, "log ", serverLogGate);
+	}
+
+	else if (strcmp(message, "logToSerial") == 0) {
+		debug_log.route(Serial);
+	}
+
+	else if (strcmp(message, "heap") == 0) {
+		heap.print(Serial);
+		heap.print(client);
+	}
+
+	else if (strcmp(message, "beatTelemetryOn") == 0) {
+		beatTelemetry = true;
+	}
+
+	else if (strcmp(message, "beatTelemetryOff") == 0) {
+		beatTelemetry = false;
+	}
+
+	else if (strcmp(message, "allocs") == 0) {
+		printProtocolAllocs(Serial);
+		printProtocolAllocs(client);
+	}
+
+	else if (strcmp(message, "stats") == 0) {
+		profiler.print(Serial);
+		profiler.print(client);
+		client.println("statsEnd");
+		profiler.reset();
+	}
+
+	else if (strcmp(message, "deleteAllDataFromDatabase") == 0) {
+		finger_scanner.emptyDatabase();
+		screens.push(TEXT_ALL_DELETED, 2000, SCREEN_RESULT);
+		client.println("deleteAllDataFromDatabase");
+	}
+}
+
+
+/**
+ * Read and execute one server command, or hand the line to the
+ * conversation waiting for it.
+*/
+void networkTask() {
+    // during a conversation lines stay queued until it asks for one.
+    if (talk != TALK_NONE && !talkWantsLine) {
+        return;
+    }
+
+    if (!server_lines.partial()) {
+        // a polled transport stamps new bytes in available().
+        client.available();
+        lineArrivedTime = client.rxStamp();
+    }
+    uint32_t allocs = allocCount();
+    bool complete = server_lines.poll(client);
+    if (!complete) {
+        protocol_allocs += allocCount() - allocs;
+        return;
+    }
+    protocol_lines++;
+    if (lineArrivedTime) {
+        profiler.record(PROFILE_COMMAND, micros() - lineArrivedTime);
+    }
+
+    const char *message = server_lines.line();
+    bool heartbeat = strcmp(message, "heartbeat") == 0;
+
+    // a heartbeat answer can still be on its way when a conversation starts.
+    bool handed = talkWantsLine && !heartbeat;
+    if (handed) {
+        strcpy(talkLine, message);
+        talkLineReady = true;
+        talkWantsLine = false;
+    }
+    protocol_allocs += allocCount() - allocs;
+
+    if (!heartbeat) {
+        wakeUp(WAKE_SERVER, lineArrivedTime ? lineArrivedTime : micros());
+    }
+    if (!handed) {
+        allocs = allocCount();
+        runCommand(message);
+        command_allocs += allocCount() - allocs;
+    }
+
+	// any traffic from the server counts as a heartbeat.
+	scheduler.postpone(heartbeat_task, millis());
+}
+
+
+
+
+/**
+ * Poll the scanner, only while a server takes the results and no
+ * conversation is running. A match is submitted by scanFinger().
+ * A new scan is still polled under an overlay so it can replace it.
+*/
+void sensorTask() {
+	if (idle.due(millis())) {
+		enterIdle();
+	}
+    if (!is_connected || talk != TALK_NONE) {
+		return;
+	}
+
+	int fingerprint_id = getFingerprintID();
+	if (fingerprint_id != -1) {
+		scan_talk.id = fingerprint_id;
+		startTalk(TALK_SCAN, scan_talk.co);
+	}
+}
+
+
+/**
+ * The scanner's touch output went high, hand it to eventTask().
+*/
+void IRAM_ATTR onFingerTouch() {
+	events.push(EVENT_FINGER_TOUCH);
+}
+
+
+/**
+ * Handle the events interrupts left in the ring.
+*/
+void eventTask() {
+	Event event;
+	while (events.pop(event)) {
+		profiler.record(PROFILE_EVENT, micros() - event.stamp);
+		switch (event.type) {
+			case EVENT_FINGER_TOUCH:
+				// a noisy pin must not keep the unit awake or the sensor
+				// busy, the poll decides whether a finger is there.
+				if (millis() - touchAccepted < TOUCH_HOLDOFF) {
+					break;
+				}
+				touchAccepted = millis();
+				touchPending = true;
+				touchStamp = event.stamp;
+				// poll now instead of at the next period.
+				scheduler.runNow(sensor_task, millis());
+				break;
+		}
+	}
+}
+
+
+/**
+ * Resume the running conversation by one step.
+*/
+void conversationTask() {
+	if (talk == TALK_NONE) {
+		return;
+	}
+	// a conversation in progress keeps the unit awake.
+	idle.activity(millis());
+
+	bool done = false;
+	switch (talk) {
+		case TALK_NONE:
+			break;
+		case TALK_ENROLL:
+			done = resumeCoroutine(enroll_talk.co, enrollFinger);
+			break;
+		case TALK_SCAN:
+			done = resumeCoroutine(scan_talk.co, scanFinger);
+			break;
+		case TALK_DELETE:
+			done = resumeCoroutine(delete_talk.co, deleteUser);
+			break;
+	}
+
+	if (done) {
+		talk = TALK_NONE;
+		talkWantsLine = false;
+		screenHeld = false;
+		scan_animation.mode = SCAN_IDLE;
+	}
+}
+
+
+/**
+ * Draw the top overlay, or the scan animation when there is none and
+ * no conversation shows its own screen. Idle units stop animating.
+*/
+void displayTask() {
+	if (!screens.update(millis()) && is_connected && !screenHeld && !idle.idle()) {
 		scanAnimation();
 	}
-}
\ No newline at end of file
+	else {
+		governor.pause();
+	}
+}
+
+
+/**
+ * Register the loop's work with the scheduler.
+*/
+void initTasks() {
+	unsigned long now = millis();
+	scheduler.setProfiler(&profiler);
+	scheduler.setWatchdog(&watchdog);
+
+	// network is left unwatched, its commands are short and conversations
+	// run step by step in the talk task.
+	heartbeat_task = scheduler.add("heartbeat", heartbeatTask, HEARTBEAT_INTERVAL, 1000, now, 50);
+	scheduler.add("network", networkTask, 0, 100, now);
+	int talk_task = scheduler.add("talk", conversationTask, 0, 50, now, SENSOR_TASK_BUDGET);
+	scheduler.add("outbox", outboxTask, OUTBOX_INTERVAL, OUTBOX_INTERVAL, now, 50);
+	sensor_task = scheduler.add("sensor", sensorTask, SENSOR_POLL_INTERVAL, SENSOR_POLL_INTERVAL, now, SENSOR_TASK_BUDGET);
+	scheduler.setRecovery(talk_task, recoverScanner, SCANNER_RECOVER_AFTER);
+	scheduler.setRecovery(sensor_task, recoverScanner, SCANNER_RECOVER_AFTER);
+	scheduler.add("display", displayTask, 0, 50, now, 50);
+	scheduler.add("events", eventTask, 0, 10, now, 50);
+	scheduler.add("telemetry", telemetryTask, HEAP_SAMPLE_INTERVAL, HEAP_SAMPLE_INTERVAL, now, 50);
+	heap.sample(now);
+
+	// awake with the modem on until IDLE_TIMEOUT passes quietly.
+	WiFi.setSleepMode(WIFI_NONE_SLEEP);
+	idle.activity(now);
+	idle.resetStats(now);
+
+	// needs the external pull-down, see the wiring above. A stray edge
+	// still only costs one early poll per TOUCH_HOLDOFF.
+	pinMode(FINGER_TOUCH, INPUT);
+	attachInterrupt(digitalPinToInterrupt(FINGER_TOUCH), onFingerTouch, RISING);
+}
+
+
+/**
+ * Initialize all connections.
+ * 
+ * Wi-Fi association is started first so it overlaps with the LCD
+ * and scanner bring-up, the server is contacted once both are done.
+*/
+void setup() {
+    Serial.begin(115200);
+    LOG_INFO("\n[i] Starting Client...");
+
+    beginWiFi();
+    markBoot(BOOT_WIFI_BEGIN);
+    initLCD();
+    markBoot(BOOT_LCD);
+    initFingerprintScanner();
+    markBoot(BOOT_SENSOR);
+    // the only waits left on the device, runtime code must not block.
+    displayText(TEXT_CONN_WIFI);
+    watchdog.begin("wifi", WIFI_BUDGET);
+    while (!checkWiFi()) {
+        delay(20);
+        debug_log.drain();
+        if (watchdog.expired()) {
+            // start the association over.
+            watchdog.end();
+            WiFi.disconnect();
+            beginWiFi();
+            watchdog.begin("wifi", WIFI_BUDGET);
+        }
+    }
+    watchdog.end();
+    markBoot(BOOT_WIFI);
+
+    LOG_INFO("\n[i] Connecting to Server");
+    displayText(TEXT_CONN_SERVER);
+    watchdog.begin("server", SERVER_BUDGET);
+    while (!connectToServer()) {
+        delay(250);
+        debug_log.drain();
+        watchdog.expired();
+    }
+    watchdog.end();
+    markBoot(BOOT_SERVER);
+
+    if (LOG_ENABLED(LOG_LEVEL_INFO)) {
+        debug_log.print("\n[i] ");
+        reportBoot(debug_log);
+        watchdog.reportReset(debug_log);
+    }
+    reportBoot(client);
+    watchdog.reportReset(client);
+
+    displayText(TEXT_READY);
+
+    initTasks();
+}
+
+
+/**
+ * The Main event loop. will listen for events and execute 
+ * functions related to events, see initTasks().
+*/
+void loop() {
+	uint32_t started = profileCycles();
+	currentTime = millis();
+	scheduler.runDue(currentTime);
+	debug_log.drain();
+	heap.track();
+	profiler.record(PROFILE_LOOP, cyclesToMicros(profileCycles() - started));
+}
@@ -0,0 +1,232 @@
+/**
+ * Display Snapshot and Bus Cost Report.
+ *
+ * Runs the firmware display stack (LcdI2C, LcdBuffer, GlyphCache,
+ * ScreenManager and the drawing in lcd_screens.h) on the host against the
+ * HD44780/PCF8574 emulator, renders every screen the firmware shows and
+ * reports what each one costs on the I2C bus.
+ *
+ *   pio run -e native_lcd -t exec                        report only
+ *   .pio/build/native_lcd/program --check src/native/lcd_screens.golden
+ *   .pio/build/native_lcd/program --write src/native/lcd_screens.golden
+ *
+ * Screens are drawn the way the firmware draws them: from the idle scan
+ * animation, so the cost is the cost of the transition a user sees.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "Arduino.h"
+#include "lcd_emulator.h"
+#include "lcd_i2c.h"
+#include "lcd_buffer.h"
+#include "screen_manager.h"
+#include "glyph_cache.h"
+#include "screen_text.h"
+#include "lcd_screens.h"
+
+#define ENROLL_STEPS 4
+
+
+struct ScreenDef {
+    const char *name;
+    ScreenText text;
+    bool overlay;
+    uint8_t step;           // non zero: progress bar of ENROLL_STEPS on row 2
+    const char *second;     // RAM second line for overlays, e.g. a name
+};
+
+
+// keep in step with the displayText()/screens.push() calls in main.cpp.
+static const ScreenDef firmware_screens[] = {
+    { "boot",             TEXT_CLIENT_START,    false, 0,            nullptr },
+    { "boot_wifi",        TEXT_CONN_WIFI,       false, 0,            nullptr },
+    { "boot_wifi_ok",     TEXT_CONN_WIFI_OK,    false, 0,            nullptr },
+    { "boot_server",      TEXT_CONN_SERVER,     false, 0,            nullptr },
+    { "boot_server_ok",   TEXT_CONN_SERVER_OK,  false, 0,            nullptr },
+    { "ready",            TEXT_READY,           false, 0,            nullptr },
+    { "disconnected",     TEXT_DISCONNECTED,    false, 0,            nullptr },
+    { "image_taken",      TEXT_IMAGE_TAKEN,     false, 0,            nullptr },
+    { "processing",       TEXT_PROCESSING,      false, 1,            nullptr },
+    { "processing_again", TEXT_PROCESSING,      false, 3,            nullptr },
+    { "remove_finger",    TEXT_REMOVE_FINGER,   false, 0,            nullptr },
+    { "place_again",      TEXT_PLACE_AGAIN,     false, 0,            nullptr },
+    { "prints_matched",   TEXT_PRINTS_MATCHED,  false, 0,            nullptr },
+    { "comm_error",       TEXT_COMM_ERROR,      false, 0,            nullptr },
+    { "prints_mismatch",  TEXT_PRINTS_MISMATCH, false, 0,            nullptr },
+    { "unknown_error",    TEXT_UNKNOWN_ERROR,   false, 0,            nullptr },
+    { "sending_data",     TEXT_SENDING_DATA,    false, ENROLL_STEPS, nullptr },
+    { "found",            TEXT_FOUND,           false, 0,            nullptr },
+    { "enroll_mode",      TEXT_ENROLL_MODE,     false, 0,            nullptr },
+    { "enroll_wait",      TEXT_ENROLL_WAIT,     false, 0,            nullptr },
+    { "rebooting",        TEXT_REBOOTING,       false, 0,            nullptr },
+    { "not_found",        TEXT_NOT_FOUND,       true,  0,            nullptr },
+    { "enroll_fail",      TEXT_ENROLL_FAIL,     true,  0,            nullptr },
+    { "enroll_ok",        TEXT_ENROLL_OK,       true,  0,            nullptr },
+    { "welcome",          TEXT_WELCOME,         true,  0,            "Juan" },
+    { "logged",           TEXT_LOGGED,          true,  0,            nullptr },
+    { "log_failed",       TEXT_LOG_FAILED,      true,  0,            nullptr },
+    { "delete_fail",      TEXT_DELETE_FAIL,     true,  0,            nullptr },
+    { "delete_ok",        TEXT_DELETE_OK,       true,  0,            nullptr },
+    { "all_deleted",      TEXT_ALL_DELETED,     true,  0,            nullptr },
+};
+
+static LcdI2C lcd(0x27, 0x10, 0x02);
+static LcdBuffer screen(lcd);
+static GlyphCache glyphs(lcd, screen);
+static ScreenManager screens(screen);
+static ScanAnimation animation;
+
+// one full lap of the head around the row
+#define IDLE_FRAMES LCD_COLS
+
+
+struct Cost {
+    BusCounters bus;
+    unsigned long us;
+};
+
+
+static void resetIdle() {
+    animation.mode = SCAN_IDLE;
+    resetScanAnimation(animation);
+    drawScanFrame(screen, glyphs, animation);
+}
+
+
+static void beginCost(Cost &cost) {
+    lcdEmulator().counters = BusCounters();
+    cost.us = micros();
+}
+
+
+static void endCost(Cost &cost) {
+    cost.bus = lcdEmulator().counters;
+    cost.us = micros() - cost.us;
+}
+
+
+static std::string snapshot(const char *name) {
+    Hd44780Emulator &emu = lcdEmulator();
+    std::string out = "== ";
+    out += name;
+    out += " ==\n";
+    for (uint8_t r = 0; r < EMU_LCD_ROWS; r++) {
+        out += "|" + emu.row(r) + "|\n";
+        std::string glyphs = emu.glyphRow(r);
+        if (!glyphs.empty()) {
+            out += " " + glyphs + "\n";
+        }
+    }
+    return out;
+}
+
+
+static void printCost(const char *name, const Cost &cost) {
+    printf("%-18s %5u %4u %5u %5u %7lu\n", name,
+           cost.bus.bytes, cost.bus.transmissions,
+           cost.bus.instructions, cost.bus.data_writes, cost.us);
+}
+
+
+static std::string readFile(const char *path) {
+    std::string text;
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return text;
+    }
+    char buf[512];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        text.append(buf, n);
+    }
+    fclose(f);
+    return text;
+}
+
+
+int main(int argc, char **argv) {
+    const char *check_path = nullptr;
+    const char *write_path = nullptr;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--check") == 0) {
+            check_path = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "--write") == 0) {
+            write_path = argv[i + 1];
+        }
+    }
+
+    std::string snapshots;
+    printf("%-18s %5s %4s %5s %5s %7s\n", "screen", "bytes", "tx", "instr", "data", "us");
+
+    Cost cost;
+    beginCost(cost);
+    initDisplay(lcd, screen, glyphs);
+    endCost(cost);
+    printCost("init", cost);
+
+    beginCost(cost);
+    resetIdle();
+    endCost(cost);
+    printCost("idle_first", cost);
+    snapshots += snapshot("idle_first");
+
+    beginCost(cost);
+    glyphs.stats = GlyphStats();
+    for (int frame = 0; frame < IDLE_FRAMES; frame++) {
+        drawScanFrame(screen, glyphs, animation);
+    }
+    endCost(cost);
+    cost.bus.bytes /= IDLE_FRAMES;
+    cost.bus.transmissions /= IDLE_FRAMES;
+    cost.bus.instructions /= IDLE_FRAMES;
+    cost.bus.data_writes /= IDLE_FRAMES;
+    cost.us /= IDLE_FRAMES;
+    printCost("idle_frame(avg)", cost);
+    printf("%-18s hits=%u uploads=%u evictions=%u misses=%u\n", "idle_glyphs",
+           glyphs.stats.hits, glyphs.stats.uploads,
+           glyphs.stats.evictions, glyphs.stats.misses);
+    snapshots += snapshot("idle_after_lap");
+
+    for (const ScreenDef &def : firmware_screens) {
+        resetIdle();
+        beginCost(cost);
+        if (def.overlay) {
+            screens.push(def.text, 1000, SCREEN_INFO, def.second);
+            screens.update(millis());
+            screens.preempt(SCREEN_ALERT);
+        }
+        else if (def.step) {
+            showProgress(screen, glyphs, def.text, def.step, ENROLL_STEPS);
+        }
+        else {
+            showScreenText(screen, def.text);
+        }
+        endCost(cost);
+        printCost(def.name, cost);
+        snapshots += snapshot(def.name);
+    }
+
+    if (write_path) {
+        FILE *f = fopen(write_path, "wb");
+        if (!f) {
+            printf("cannot write %s\n", write_path);
+            return 1;
+        }
+        fwrite(snapshots.data(), 1, snapshots.size(), f);
+        fclose(f);
+        printf("\nsnapshots written to %s\n", write_path);
+    }
+
+    if (check_path) {
+        std::string golden = readFile(check_path);
+        if (golden != snapshots) {
+            printf("\nsnapshots differ from %s:\n%s", check_path, snapshots.c_str());
+            return 1;
+        }
+        printf("\nsnapshots match %s\n", check_path);
+    }
+    return 0;
+}
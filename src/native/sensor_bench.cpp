@@ -0,0 +1,279 @@
+/**
+ * Sensor Throughput Benchmark.
+ *
+ * Runs the scan and enroll command sequences of src/main.cpp through the
+ * real Adafruit_Fingerprint library, talking to the fingerprint sensor
+ * emulator over a SensorStream, and reports how long each takes in
+ * virtual time. Build and run it on the host with:
+ *
+ *   pio run -e native -t exec
+ *
+ * FirmwareTiming holds the getImage polling intervals of the firmware.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <Adafruit_Fingerprint.h>
+#include "sensor_emulator.h"
+#include "sensor_stream.h"
+#include "sensor_profile.h"
+
+#define MS(x) ((uint64_t)(x) * 1000ULL)
+
+
+struct FirmwareTiming {
+    uint32_t poll_ms = 50;              // animInterval between getImage polls
+    uint32_t remove_poll_ms = 2000;     // "Remove Finger" polling in enroll
+};
+
+
+struct UserTiming {
+    uint32_t hold_ms = 1500;            // finger stays on the window
+    uint32_t react_ms = 800;            // reaction to an on-screen prompt
+    uint32_t gap_ms = 500;              // next attendee steps up
+};
+
+
+struct Phase {
+    const char *name;
+    uint64_t total_us = 0;
+    uint64_t max_us = 0;
+    uint32_t count = 0;
+
+    explicit Phase(const char *name) : name(name) {}
+
+    void add(uint64_t us) {
+        total_us += us;
+        count++;
+        if (us > max_us) {
+            max_us = us;
+        }
+    }
+
+    void print() const {
+        printf("  %-22s n=%-5u avg=%8.1f ms  max=%8.1f ms\n", name, count,
+               count ? total_us / 1000.0 / count : 0.0, max_us / 1000.0);
+    }
+};
+
+
+/**
+ * Connect the library the way initFingerprintScanner() does, begin() is
+ * not called there either.
+*/
+static bool openSensor(Adafruit_Fingerprint &finger) {
+    return finger.verifyPassword() && finger.getParameters() == FINGERPRINT_OK;
+}
+
+
+/**
+ * Poll getImage every `poll_ms` until the wanted result comes back.
+*/
+static void pollImage(SensorStream &uart, Adafruit_Fingerprint &finger, uint32_t poll_ms, uint8_t wanted) {
+    while (true) {
+        uint64_t started = uart.sync();
+        if (finger.getImage() == wanted) {
+            return;
+        }
+        uint64_t spent = uart.sync() - started;
+        if (spent < MS(poll_ms)) {
+            hostAdvance((unsigned long)(MS(poll_ms) - spent));
+        }
+    }
+}
+
+
+static void benchScan(const SensorConfig &cfg, const FirmwareTiming &fw, const UserTiming &user, int attendees) {
+    SensorEmulator sensor(cfg);
+    SensorStream uart(sensor);
+    Adafruit_Fingerprint finger(&uart);
+
+    for (uint16_t id = 1; id <= 100 && id < cfg.capacity; id++) {
+        sensor.storeTemplate(id, id);
+    }
+    if (!openSensor(finger)) {
+        printf("scan: emulator handshake failed\n");
+        return;
+    }
+
+    Phase detect("touch -> image taken");
+    Phase match("image -> match");
+    Phase ready("touch -> id ready");
+    Phase cycle("touch -> next scan");
+
+    uint64_t bench_start = uart.sync();
+    SensorCounters before = sensor.counters();
+    for (int i = 0; i < attendees; i++) {
+        int id = 1 + (i * 37) % 100;
+        uint64_t touch = uart.sync() + MS(user.gap_ms);
+        sensor.scheduleFinger(touch, id);
+        sensor.scheduleFinger(touch + MS(user.hold_ms), EMU_NO_FINGER);
+
+        pollImage(uart, finger, fw.poll_ms, FINGERPRINT_OK);
+        detect.add(uart.sync() - touch);
+
+        uint64_t image_at = uart.sync();
+        if (finger.image2Tz() == FINGERPRINT_OK) {
+            finger.fingerSearch();
+        }
+        match.add(uart.sync() - image_at);
+        ready.add(uart.sync() - touch);
+
+        // the firmware only takes a new scan once the finger was lifted.
+        pollImage(uart, finger, fw.poll_ms, FINGERPRINT_NOFINGER);
+        cycle.add(uart.sync() - touch);
+    }
+    uint64_t elapsed = uart.sync() - bench_start;
+
+    printf("scan: %d attendees in %.1f s, %.1f scans/min\n", attendees,
+           elapsed / 1e6, attendees * 60e6 / elapsed);
+    detect.print();
+    match.print();
+    ready.print();
+    cycle.print();
+    printf("  uart %llu bytes out, %llu bytes in, sensor busy %.1f%%\n",
+           (unsigned long long)(sensor.counters().tx_bytes - before.tx_bytes),
+           (unsigned long long)(sensor.counters().rx_bytes - before.rx_bytes),
+           100.0 * (sensor.counters().busy_us - before.busy_us) / elapsed);
+}
+
+
+static void benchEnroll(const SensorConfig &cfg, const FirmwareTiming &fw, const UserTiming &user, int enrollments) {
+    SensorEmulator sensor(cfg);
+    SensorStream uart(sensor);
+    Adafruit_Fingerprint finger(&uart);
+
+    if (!openSensor(finger)) {
+        printf("enroll: emulator handshake failed\n");
+        return;
+    }
+
+    Phase first("first image");
+    Phase lift("remove finger");
+    Phase second("second image");
+    Phase model("model + store");
+    Phase total("enrollment");
+
+    uint64_t bench_start = uart.sync();
+    for (int i = 0; i < enrollments; i++) {
+        uint16_t id = (uint16_t)(1 + i % (cfg.capacity - 1));
+        int placed = 1000 + i;
+        uint64_t started = uart.sync();
+
+        sensor.scheduleFinger(started + MS(user.react_ms), placed);
+        pollImage(uart, finger, fw.poll_ms, FINGERPRINT_OK);
+        finger.image2Tz(1);
+        first.add(uart.sync() - started);
+
+        uint64_t prompt = uart.sync();
+        sensor.scheduleFinger(prompt + MS(user.react_ms), EMU_NO_FINGER);
+        pollImage(uart, finger, fw.remove_poll_ms, FINGERPRINT_NOFINGER);
+        lift.add(uart.sync() - prompt);
+
+        prompt = uart.sync();
+        sensor.scheduleFinger(prompt + MS(user.react_ms), placed);
+        pollImage(uart, finger, fw.poll_ms, FINGERPRINT_OK);
+        finger.image2Tz(2);
+        second.add(uart.sync() - prompt);
+
+        uint64_t modelled = uart.sync();
+        if (finger.createModel() == FINGERPRINT_OK) {
+            finger.storeModel(id);
+        }
+        model.add(uart.sync() - modelled);
+
+        sensor.scheduleFinger(uart.sync() + MS(user.react_ms), EMU_NO_FINGER);
+        hostAdvance(MS(user.react_ms));
+        total.add(uart.sync() - started);
+    }
+    uint64_t elapsed = uart.sync() - bench_start;
+
+    printf("enroll: %d fingers in %.1f s, %.1f enrollments/min\n", enrollments,
+           elapsed / 1e6, enrollments * 60e6 / elapsed);
+    first.print();
+    lift.print();
+    second.print();
+    model.print();
+    total.print();
+}
+
+
+/**
+ * Two boots of initFingerprintScanner() against one sensor: the first
+ * probes and saves the profile, the second trusts the stored one. A
+ * finger enrolled above the library's default capacity of 64 must still
+ * be found after the second boot.
+*/
+static bool benchCachedBoot(const SensorConfig &cfg) {
+    SensorEmulator sensor(cfg);
+    SensorStream uart(sensor);
+    uint16_t id = cfg.capacity - 1;
+    SensorProfile profile;
+
+    clearSensorProfile();
+    Adafruit_Fingerprint first(&uart);
+    if (!first.verifyPassword() || !probeSensorProfile(first, profile)) {
+        printf("cached boot: emulator handshake failed\n");
+        return false;
+    }
+    saveSensorProfile(profile);
+    sensor.storeTemplate(id, 42);
+
+    Adafruit_Fingerprint second(&uart);
+    uint64_t boot = uart.sync();
+    if (!second.verifyPassword() || !loadSensorProfile(profile)) {
+        printf("cached boot: no stored profile\n");
+        return false;
+    }
+    applySensorProfile(profile, second);
+    uint64_t booted = uart.sync() - boot;
+
+    sensor.placeFinger(42);
+    bool found = second.getImage() == FINGERPRINT_OK
+              && second.image2Tz() == FINGERPRINT_OK
+              && second.fingerSearch() == FINGERPRINT_OK
+              && second.fingerID == id;
+    sensor.liftFinger();
+
+    printf("cached boot: handshake %.1f ms, finger at id %u %s\n",
+           booted / 1000.0, id, found ? "found" : "NOT FOUND");
+    return found;
+}
+
+
+int main(int argc, char **argv) {
+    SensorConfig cfg;
+    FirmwareTiming fw;
+    UserTiming user;
+    int count = 50;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--baud") == 0 && i + 1 < argc) {
+            cfg.baud = (uint32_t)atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+            count = atoi(argv[++i]);
+        }
+        else {
+            printf("usage: %s [--baud n] [--count n]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    SensorEmulator probe(cfg);
+    SensorStream uart(probe);
+    Adafruit_Fingerprint finger(&uart);
+    if (!openSensor(finger)) {
+        printf("emulator handshake failed\n");
+        return 1;
+    }
+    printf("sensor: capacity %u, security %u, packet %u bytes, %lu baud\n\n",
+           finger.capacity, finger.security_level, finger.packet_len, (unsigned long)cfg.baud);
+
+    benchScan(cfg, fw, user, count);
+    printf("\n");
+    benchEnroll(cfg, fw, user, count / 5 > 0 ? count / 5 : 1);
+    printf("\n");
+    return benchCachedBoot(cfg) ? 0 : 1;
+}
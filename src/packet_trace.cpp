@@ -0,0 +1,263 @@
+#include "packet_trace.h"
+#include "Adafruit_Fingerprint.h"
+
+
+void PacketParser::reset() {
+    index = 0;
+    length = 0;
+}
+
+
+bool PacketParser::feed(uint8_t b) {
+    switch (index) {
+        case 0:
+            if (b != (FINGERPRINT_STARTCODE >> 8)) {
+                return false;
+            }
+            break;
+        case 1:
+            if (b != (FINGERPRINT_STARTCODE & 0xFF)) {
+                // the byte may itself be the start of the next header
+                index = (b == (FINGERPRINT_STARTCODE >> 8)) ? 1 : 0;
+                return false;
+            }
+            break;
+        case 6:
+            pid = b;
+            break;
+        case 7:
+            length = (uint16_t)b << 8;
+            break;
+        case 8:
+            length |= b;
+            break;
+        case 9:
+            code = b;
+            break;
+    }
+
+    index++;
+    if (index > 8 && index == 9 + length) {
+        reset();
+        return true;
+    }
+    return false;
+}
+
+
+TracedStream::TracedStream(Stream &inner) : inner(inner) {}
+
+
+int TracedStream::available() {
+    return inner.available();
+}
+
+
+int TracedStream::peek() {
+    return inner.peek();
+}
+
+
+int TracedStream::read() {
+    int b = inner.read();
+    if (b < 0 || !enabled) {
+        return b;
+    }
+
+    if (pending) {
+        current.rx_bytes++;
+    }
+    else if (trailing) {
+        // data packets after the acknowledge belong to the same command.
+        ring[(ring_head + TRACE_RING_SIZE - 1) % TRACE_RING_SIZE].rx_bytes++;
+    }
+
+    if (rx_parser.feed((uint8_t)b) && rx_parser.pid == FINGERPRINT_ACKPACKET) {
+        onReply(rx_parser.code, micros());
+    }
+    return b;
+}
+
+
+size_t TracedStream::write(uint8_t b) {
+    if (enabled) {
+        if (!tx_started) {
+            tx_start_us = micros();
+            tx_count = 0;
+            tx_started = true;
+        }
+        tx_count++;
+        if (tx_parser.feed(b)) {
+            tx_started = false;
+            if (tx_parser.pid == FINGERPRINT_COMMANDPACKET) {
+                onCommand(tx_parser.code, tx_start_us);
+            }
+            else if (pending) {
+                current.tx_bytes += tx_count;
+            }
+        }
+    }
+    return inner.write(b);
+}
+
+
+void TracedStream::flush() {
+    inner.flush();
+}
+
+
+void TracedStream::setEnabled(bool enabled) {
+    this->enabled = enabled;
+    tx_parser.reset();
+    rx_parser.reset();
+    tx_started = false;
+    pending = false;
+    trailing = false;
+}
+
+
+void TracedStream::clear() {
+    ring_head = 0;
+    ring_count = 0;
+    summary_count = 0;
+    pending = false;
+    trailing = false;
+}
+
+
+void TracedStream::onCommand(uint8_t command, unsigned long start_us) {
+    if (pending) {
+        // the previous command never got an answer, the library timed out.
+        commit(start_us - cmd_start_us);
+    }
+
+    current.command = command;
+    current.reply = TRACE_NO_REPLY;
+    current.tx_bytes = tx_count;
+    current.rx_bytes = 0;
+    current.duration_us = 0;
+    cmd_start_us = start_us;
+    pending = true;
+    trailing = false;
+}
+
+
+void TracedStream::onReply(uint8_t reply, unsigned long now) {
+    if (!pending) {
+        return;
+    }
+    current.reply = reply;
+    commit(now - cmd_start_us);
+    trailing = true;
+}
+
+
+void TracedStream::commit(uint32_t duration_us) {
+    current.duration_us = duration_us;
+    pending = false;
+
+    ring[ring_head] = current;
+    ring_head = (ring_head + 1) % TRACE_RING_SIZE;
+    if (ring_count < TRACE_RING_SIZE) {
+        ring_count++;
+    }
+
+    TraceSummary *s = summaryFor(current.command);
+    if (s == nullptr) {
+        return;
+    }
+    s->count++;
+    if (current.reply != FINGERPRINT_OK) {
+        s->failures++;
+    }
+    s->total_us += duration_us;
+    if (duration_us > s->max_us) {
+        s->max_us = duration_us;
+    }
+}
+
+
+TraceSummary *TracedStream::summaryFor(uint8_t command) {
+    for (uint8_t i = 0; i < summary_count; i++) {
+        if (summary[i].command == command) {
+            return &summary[i];
+        }
+    }
+    if (summary_count >= TRACE_SUMMARY_SIZE) {
+        return nullptr;
+    }
+
+    TraceSummary *s = &summary[summary_count++];
+    s->command = command;
+    s->count = 0;
+    s->failures = 0;
+    s->total_us = 0;
+    s->max_us = 0;
+    return s;
+}
+
+
+const TraceRecord *TracedStream::last() const {
+    if (ring_count == 0) {
+        return nullptr;
+    }
+    return &ring[(ring_head + TRACE_RING_SIZE - 1) % TRACE_RING_SIZE];
+}
+
+
+void TracedStream::dump(Print &out) {
+    out.print("\n[t] sensor trace, ");
+    out.print(ring_count);
+    out.println(" packets");
+
+    uint8_t start = (ring_head + TRACE_RING_SIZE - ring_count) % TRACE_RING_SIZE;
+    for (uint8_t i = 0; i < ring_count; i++) {
+        const TraceRecord &r = ring[(start + i) % TRACE_RING_SIZE];
+        out.print("[t] ");
+        out.print(traceCommandName(r.command));
+        out.print(" reply=0x");
+        out.print(r.reply, HEX);
+        out.print(" tx=");
+        out.print(r.tx_bytes);
+        out.print(" rx=");
+        out.print(r.rx_bytes);
+        out.print(" us=");
+        out.println(r.duration_us);
+    }
+
+    dumpSummary(out);
+}
+
+
+void TracedStream::dumpSummary(Print &out) {
+    out.println("[t] command        n   fail  avg(us)  max(us)");
+    for (uint8_t i = 0; i < summary_count; i++) {
+        const TraceSummary &s = summary[i];
+        char line[56];
+        snprintf(line, sizeof(line), "[t] %-12s %4u %5u %8lu %8lu",
+                 traceCommandName(s.command), s.count, s.failures,
+                 (unsigned long)(s.count ? s.total_us / s.count : 0),
+                 (unsigned long)s.max_us);
+        out.println(line);
+    }
+}
+
+
+const char *traceCommandName(uint8_t command) {
+    switch (command) {
+        case FINGERPRINT_GETIMAGE:       return "getImage";
+        case FINGERPRINT_IMAGE2TZ:       return "image2Tz";
+        case FINGERPRINT_SEARCH:         return "search";
+        case FINGERPRINT_REGMODEL:       return "createModel";
+        case FINGERPRINT_STORE:          return "storeModel";
+        case FINGERPRINT_LOAD:           return "loadModel";
+        case FINGERPRINT_UPLOAD:         return "getModel";
+        case FINGERPRINT_DELETE:         return "deleteModel";
+        case FINGERPRINT_EMPTY:          return "emptyDB";
+        case FINGERPRINT_READSYSPARAM:   return "readParams";
+        case FINGERPRINT_VERIFYPASSWORD: return "verifyPass";
+        case FINGERPRINT_HISPEEDSEARCH:  return "fastSearch";
+        case FINGERPRINT_TEMPLATECOUNT:  return "tmplCount";
+        default:                         return "other";
+    }
+}
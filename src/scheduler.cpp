@@ -0,0 +1,249 @@
+#include "scheduler.h"
+
+
+/**
+ * Due times wrap with millis(), compare them by difference.
+*/
+bool Scheduler::earlier(uint8_t a, uint8_t b) const {
+    return (long)(tasks[a].due - tasks[b].due) < 0;
+}
+
+
+void Scheduler::push(uint8_t id) {
+    if (heap_size >= SCHED_MAX_TASKS) {
+        return;
+    }
+    uint8_t i = heap_size++;
+    heap[i] = id;
+    while (i > 0) {
+        uint8_t parent = (i - 1) / 2;
+        if (!earlier(heap[i], heap[parent])) {
+            break;
+        }
+        uint8_t swap = heap[i];
+        heap[i] = heap[parent];
+        heap[parent] = swap;
+        i = parent;
+    }
+}
+
+
+uint8_t Scheduler::pop() {
+    uint8_t top = heap[0];
+    heap[0] = heap[--heap_size];
+
+    uint8_t i = 0;
+    while (true) {
+        uint8_t left = 2 * i + 1;
+        uint8_t right = left + 1;
+        uint8_t first = i;
+        if (left < heap_size && earlier(heap[left], heap[first])) {
+            first = left;
+        }
+        if (right < heap_size && earlier(heap[right], heap[first])) {
+            first = right;
+        }
+        if (first == i) {
+            break;
+        }
+        uint8_t swap = heap[i];
+        heap[i] = heap[first];
+        heap[first] = swap;
+        i = first;
+    }
+    return top;
+}
+
+
+int Scheduler::add(const char *name, TaskFunction run, unsigned long period, unsigned long deadline, unsigned long now,
+                   unsigned long budget) {
+    if (count >= SCHED_MAX_TASKS) {
+        return SCHED_NO_TASK;
+    }
+
+    Task &task = tasks[count];
+    task.name = name;
+    task.run = run;
+    task.period = period;
+    task.deadline = deadline;
+    task.budget = budget;
+    task.recover = nullptr;
+    task.recover_after = 1;
+    task.overrun_streak = 0;
+    task.due = now + period;
+    task.in_flight = false;
+    task.moved = false;
+    memset(&task.stats, 0, sizeof(task.stats));
+    if (profiler) {
+        profiler->name(count + 1, name);
+    }
+    push(count);
+    return count++;
+}
+
+
+void Scheduler::runDue(unsigned long now) {
+    // take the due tasks out first, so a period 0 task runs once per pass.
+    uint8_t ready[SCHED_MAX_TASKS];
+    uint8_t ready_count = 0;
+    while (heap_size > 0 && (long)(now - tasks[heap[0]].due) >= 0) {
+        uint8_t id = pop();
+        tasks[id].in_flight = true;
+        tasks[id].moved = false;
+        ready[ready_count++] = id;
+    }
+
+    for (uint8_t i = 0; i < ready_count; i++) {
+        Task &task = tasks[ready[i]];
+        if (task.moved && (long)(now - task.due) < 0) {
+            // postponed by a task that ran before it in this pass.
+            task.in_flight = false;
+            push(ready[i]);
+            continue;
+        }
+        task.moved = false;
+
+        unsigned long started = millis();
+        unsigned long late = started - task.due;
+        if (late > task.stats.max_late) {
+            task.stats.max_late = late;
+        }
+        if (late > task.deadline) {
+            task.stats.missed++;
+        }
+
+        bool watched = watchdog && task.budget > 0;
+        if (watched) {
+            watchdog->begin(task.name, task.budget);
+        }
+        uint32_t started_cycles = profileCycles();
+        task.run();
+        bool overran = watched && watchdog->end();
+        unsigned long took = cyclesToMicros(profileCycles() - started_cycles);
+        if (profiler) {
+            profiler->record(ready[i] + 1, took);
+        }
+
+        task.stats.runs++;
+        task.stats.total_us += took;
+        if (took > task.stats.max_us) {
+            task.stats.max_us = took;
+        }
+        if (overran) {
+            task.stats.overruns++;
+            if (task.recover && ++task.overrun_streak >= task.recover_after) {
+                task.overrun_streak = 0;
+                task.recover();
+            }
+        }
+        else {
+            task.overrun_streak = 0;
+        }
+
+        // keep the period's phase, skip the periods already missed, unless
+        // the task was rescheduled while it ran.
+        if (!task.moved) {
+            task.due += task.period;
+            if ((long)(millis() - task.due) > 0) {
+                task.due = millis() + task.period;
+            }
+        }
+        task.in_flight = false;
+        push(ready[i]);
+    }
+}
+
+
+void Scheduler::postpone(int id, unsigned long now) {
+    if (id < 0 || id >= count) {
+        return;
+    }
+    reschedule(id, now + tasks[id].period);
+}
+
+
+void Scheduler::runNow(int id, unsigned long now) {
+    reschedule(id, now);
+}
+
+
+void Scheduler::setPeriod(int id, unsigned long period) {
+    if (id < 0 || id >= count) {
+        return;
+    }
+    tasks[id].period = period;
+}
+
+
+void Scheduler::setRecovery(int id, TaskFunction recover, uint8_t after) {
+    if (id < 0 || id >= count) {
+        return;
+    }
+    tasks[id].recover = recover;
+    tasks[id].recover_after = after > 0 ? after : 1;
+    tasks[id].overrun_streak = 0;
+}
+
+
+void Scheduler::reschedule(int id, unsigned long due) {
+    if (id < 0 || id >= count) {
+        return;
+    }
+    if (tasks[id].in_flight) {
+        // runDue() holds it and puts it back when done.
+        tasks[id].due = due;
+        tasks[id].moved = true;
+        return;
+    }
+
+    // pull it out of the heap and put it back with the new due time.
+    uint8_t kept[SCHED_MAX_TASKS];
+    uint8_t kept_count = 0;
+    while (heap_size > 0) {
+        uint8_t next = pop();
+        if (next != id) {
+            kept[kept_count++] = next;
+        }
+    }
+    tasks[id].due = due;
+    push(id);
+    for (uint8_t i = 0; i < kept_count; i++) {
+        push(kept[i]);
+    }
+}
+
+
+void Scheduler::setProfiler(LoopProfiler *profiler) {
+    this->profiler = profiler;
+    for (uint8_t i = 0; profiler && i < count; i++) {
+        profiler->name(i + 1, tasks[i].name);
+    }
+}
+
+
+void Scheduler::resetStats() {
+    for (uint8_t i = 0; i < count; i++) {
+        memset(&tasks[i].stats, 0, sizeof(tasks[i].stats));
+    }
+}
+
+
+void Scheduler::printStats(Print &out) {
+    for (uint8_t i = 0; i < count; i++) {
+        const Task &task = tasks[i];
+        out.print(task.name);
+        out.print(" runs=");
+        out.print(task.stats.runs);
+        out.print(" avg(us)=");
+        out.print(task.stats.runs ? task.stats.total_us / task.stats.runs : 0);
+        out.print(" max(us)=");
+        out.print(task.stats.max_us);
+        out.print(" maxLate(ms)=");
+        out.print(task.stats.max_late);
+        out.print(" missed=");
+        out.print(task.stats.missed);
+        out.print(" overruns=");
+        out.print(task.stats.overruns);
+        out.print("\n");
+    }
+}
@@ -0,0 +1,103 @@
+#include "screen_manager.h"
+
+
+ScreenManager::ScreenManager(LcdBuffer &screen) : screen(screen) {}
+
+
+/**
+ * Copy a line padded with spaces to the full display width, an overlay
+ * always covers every cell under it.
+*/
+static void copyLine(char *dest, const char *src) {
+    dest[LCD_COLS] = '\0';
+    if (src == nullptr) {
+        memset(dest, ' ', LCD_COLS);
+        return;
+    }
+
+    size_t len = strlen(src);
+    if (len > LCD_COLS) {
+        len = LCD_COLS;
+    }
+    memcpy(dest, src, len);
+    memset(dest + len, ' ', LCD_COLS - len);
+}
+
+
+bool ScreenManager::push(const char *firstLine, const char *secondLine, unsigned long dwell, uint8_t priority) {
+    if (depth >= SCREEN_STACK_SIZE) {
+        return false;
+    }
+
+    // stack[depth - 1] is the top, find the place above lower priorities.
+    uint8_t slot = depth;
+    while (slot > 0 && stack[slot - 1].priority > priority) {
+        stack[slot] = stack[slot - 1];
+        slot--;
+    }
+
+    Overlay &o = stack[slot];
+    copyLine(o.lines[0], firstLine);
+    copyLine(o.lines[1], secondLine);
+    o.dwell = dwell;
+    o.shown_at = 0;
+    o.priority = priority;
+    o.visible = false;
+    depth++;
+
+    // a screen that was covered gets its full dwell again later.
+    for (uint8_t i = 0; i + 1 < depth; i++) {
+        stack[i].visible = false;
+    }
+    return true;
+}
+
+
+bool ScreenManager::push(ScreenText text, unsigned long dwell, uint8_t priority, const char *secondLine) {
+    char first[LCD_COLS + 1];
+    char second[LCD_COLS + 1];
+    copyScreenLine(first, sizeof(first), text, 0);
+    if (!secondLine) {
+        copyScreenLine(second, sizeof(second), text, 1);
+        secondLine = second;
+    }
+    return push(first, secondLine, dwell, priority);
+}
+
+
+void ScreenManager::preempt(uint8_t priority) {
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < depth; i++) {
+        if (stack[i].priority > priority) {
+            stack[kept++] = stack[i];
+        }
+    }
+    depth = kept;
+}
+
+
+bool ScreenManager::update(unsigned long now) {
+    while (depth > 0) {
+        Overlay &top = stack[depth - 1];
+        if (!top.visible) {
+            top.visible = true;
+            top.shown_at = now;
+        }
+        if (now - top.shown_at < top.dwell) {
+            break;
+        }
+        depth--;
+    }
+
+    if (depth == 0) {
+        return false;
+    }
+
+    const Overlay &top = stack[depth - 1];
+    screen.setCursor(0, 0);
+    screen.print(top.lines[0]);
+    screen.setCursor(0, 1);
+    screen.print(top.lines[1]);
+    screen.refresh();
+    return true;
+}
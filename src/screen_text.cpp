@@ -0,0 +1,106 @@
+#include "screen_text.h"
+
+// lines shared by several screens are stored once.
+static const char line_empty[] PROGMEM = "";
+static const char line_client_start[] PROGMEM = "  Client Start  ";
+static const char line_conn_wifi[] PROGMEM = "   conn WiFi   ";
+static const char line_conn_wifi_ok[] PROGMEM = "   conn WiFi.   ";
+static const char line_conn_server[] PROGMEM = "  conn Server   ";
+static const char line_conn_server_ok[] PROGMEM = "  conn Server.   ";
+static const char line_disconnected[] PROGMEM = "  Disconnected  ";
+static const char line_please_reset[] PROGMEM = "  please reset  ";
+static const char line_scan[] PROGMEM = "Scan Your Finger";
+static const char line_scan_finger[] PROGMEM = "  Scan  Finger  ";
+static const char line_enroll_scan[] PROGMEM = " Enroll  Finger ";
+static const char line_lcd_bench[] PROGMEM = " LCD  Benchmark ";
+static const char line_image_taken[] PROGMEM = "  Image  Taken  ";
+static const char line_please_wait[] PROGMEM = " please wait... ";
+static const char line_processing[] PROGMEM = "   Processing   ";
+static const char line_image[] PROGMEM = "    Image...    ";
+static const char line_dashes[] PROGMEM = "      ----      ";
+static const char line_remove_finger[] PROGMEM = " Remove Finger  ";
+static const char line_place_same[] PROGMEM = "   Place Same   ";
+static const char line_finger_again[] PROGMEM = "  Finger again  ";
+static const char line_fingerprints[] PROGMEM = "  Fingerprints  ";
+static const char line_matched[] PROGMEM = "    Matched     ";
+static const char line_did_not_match[] PROGMEM = " Did Not Match  ";
+static const char line_communication[] PROGMEM = " Communication  ";
+static const char line_error[] PROGMEM = "     Error      ";
+static const char line_unknown[] PROGMEM = "    Unknown     ";
+static const char line_sending_data[] PROGMEM = "  Sending Data  ";
+static const char line_to_database[] PROGMEM = "  to Database   ";
+static const char line_fingerprint[] PROGMEM = "  Fingerprint   ";
+static const char line_is_found[] PROGMEM = "    is found    ";
+static const char line_did_not_find[] PROGMEM = "  Did not Find  ";
+static const char line_match[] PROGMEM = "     Match      ";
+static const char line_enrollment[] PROGMEM = "   Enrollment   ";
+static const char line_mode[] PROGMEM = "      Mode      ";
+static const char line_waiting_for[] PROGMEM = " Waiting for  ";
+static const char line_feedback[] PROGMEM = "  Feedback...   ";
+static const char line_enroll_fail[] PROGMEM = "  Enroll Fail!  ";
+static const char line_try_again[] PROGMEM = "   Try  Again   ";
+static const char line_success[] PROGMEM = "    Success!    ";
+static const char line_welcome[] PROGMEM = "Welcome:        ";
+static const char line_successfully[] PROGMEM = "  Successfully  ";
+static const char line_logged[] PROGMEM = "  Logged to DB  ";
+static const char line_failed_logging[] PROGMEM = " Failed logging ";
+static const char line_attendance[] PROGMEM = "   Attendance   ";
+static const char line_delete[] PROGMEM = "     Delete     ";
+static const char line_fail[] PROGMEM = "      Fail!     ";
+static const char line_all_data[] PROGMEM = "  ALL DATA IS   ";
+static const char line_deleted[] PROGMEM = "    DELETED!    ";
+static const char line_rebooting[] PROGMEM = "  Rebooting...  ";
+
+
+// indexed by ScreenText, keep in the enum's order.
+static const char *const screen_lines[TEXT_COUNT][2] PROGMEM = {
+    { line_client_start,   line_empty },            // TEXT_CLIENT_START
+    { line_client_start,   line_conn_wifi },        // TEXT_CONN_WIFI
+    { line_client_start,   line_conn_wifi_ok },     // TEXT_CONN_WIFI_OK
+    { line_client_start,   line_conn_server },      // TEXT_CONN_SERVER
+    { line_client_start,   line_conn_server_ok },   // TEXT_CONN_SERVER_OK
+    { line_disconnected,   line_please_reset },     // TEXT_DISCONNECTED
+    { line_scan,           line_empty },            // TEXT_SCAN
+    { line_enroll_scan,    line_empty },            // TEXT_ENROLL_SCAN
+    { line_scan,           line_lcd_bench },        // TEXT_LCD_BENCH
+    { line_image_taken,    line_please_wait },      // TEXT_IMAGE_TAKEN
+    { line_processing,     line_image },            // TEXT_PROCESSING
+    { line_dashes,         line_remove_finger },    // TEXT_REMOVE_FINGER
+    { line_place_same,     line_finger_again },     // TEXT_PLACE_AGAIN
+    { line_fingerprints,   line_matched },          // TEXT_PRINTS_MATCHED
+    { line_communication,  line_error },            // TEXT_COMM_ERROR
+    { line_fingerprints,   line_did_not_match },    // TEXT_PRINTS_MISMATCH
+    { line_unknown,        line_error },            // TEXT_UNKNOWN_ERROR
+    { line_sending_data,   line_to_database },      // TEXT_SENDING_DATA
+    { line_fingerprint,    line_is_found },         // TEXT_FOUND
+    { line_did_not_find,   line_match },            // TEXT_NOT_FOUND
+    { line_enrollment,     line_mode },             // TEXT_ENROLL_MODE
+    { line_waiting_for,    line_feedback },         // TEXT_ENROLL_WAIT
+    { line_enroll_fail,    line_try_again },        // TEXT_ENROLL_FAIL
+    { line_enrollment,     line_success },          // TEXT_ENROLL_OK
+    { line_welcome,        line_empty },            // TEXT_WELCOME
+    { line_successfully,   line_logged },           // TEXT_LOGGED
+    { line_failed_logging, line_attendance },       // TEXT_LOG_FAILED
+    { line_delete,         line_fail },             // TEXT_DELETE_FAIL
+    { line_delete,         line_success },          // TEXT_DELETE_OK
+    { line_all_data,       line_deleted },          // TEXT_ALL_DELETED
+    { line_dashes,         line_rebooting },        // TEXT_REBOOTING
+    { line_scan_finger,    line_conn_server_ok },   // TEXT_READY
+};
+
+
+const char *screenLine(ScreenText text, uint8_t row) {
+    if (text >= TEXT_COUNT || row > 1) {
+        return line_empty;
+    }
+    return (const char *)pgm_read_ptr(&screen_lines[text][row]);
+}
+
+
+void copyScreenLine(char *dest, size_t size, ScreenText text, uint8_t row) {
+    if (size == 0) {
+        return;
+    }
+    strncpy_P(dest, screenLine(text, row), size - 1);
+    dest[size - 1] = '\0';
+}
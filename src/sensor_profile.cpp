@@ -0,0 +1,117 @@
+#include "sensor_profile.h"
+#include "EEPROM.h"
+
+
+/**
+ * CRC-16/CCITT over the profile, the checksum field excluded.
+*/
+static uint16_t profileChecksum(const SensorProfile &profile) {
+    const uint8_t *data = (const uint8_t *)&profile;
+    size_t len = offsetof(SensorProfile, checksum);
+    uint16_t crc = 0xFFFF;
+
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+
+bool loadSensorProfile(SensorProfile &profile) {
+    SensorProfile stored;
+    EEPROM.begin(EEPROM_SIZE);
+    EEPROM.get(SENSOR_PROFILE_ADDR, stored);
+    EEPROM.end();
+
+    // blank or stale flash must not leak into the capacity checks.
+    if (stored.magic != SENSOR_PROFILE_MAGIC
+        || stored.version != SENSOR_PROFILE_VERSION
+        || stored.checksum != profileChecksum(stored)
+        || stored.capacity == 0) {
+        return false;
+    }
+    profile = stored;
+    return true;
+}
+
+
+void saveSensorProfile(SensorProfile &profile) {
+    profile.magic = SENSOR_PROFILE_MAGIC;
+    profile.version = SENSOR_PROFILE_VERSION;
+    profile.reserved = 0;
+    profile.checksum = profileChecksum(profile);
+
+    EEPROM.begin(EEPROM_SIZE);
+    EEPROM.put(SENSOR_PROFILE_ADDR, profile);
+    EEPROM.commit();
+    EEPROM.end();
+}
+
+
+void clearSensorProfile() {
+    EEPROM.begin(EEPROM_SIZE);
+    for (size_t i = 0; i < sizeof(SensorProfile); i++) {
+        EEPROM.write(SENSOR_PROFILE_ADDR + i, 0xFF);
+    }
+    EEPROM.commit();
+    EEPROM.end();
+}
+
+
+bool probeSensorProfile(Adafruit_Fingerprint &scanner, SensorProfile &profile) {
+    if (scanner.getParameters() != FINGERPRINT_OK) {
+        return false;
+    }
+
+    defaultSensorProfile(scanner, profile);
+    return profile.capacity > 0;
+}
+
+
+void defaultSensorProfile(Adafruit_Fingerprint &scanner, SensorProfile &profile) {
+    memset(&profile, 0, sizeof(profile));
+    profile.system_id = scanner.system_id;
+    profile.capacity = scanner.capacity;
+    profile.security_level = scanner.security_level;
+    profile.packet_len = scanner.packet_len;
+    profile.device_addr = scanner.device_addr;
+    profile.baud_rate = scanner.baud_rate;
+}
+
+
+void applySensorProfile(const SensorProfile &profile, Adafruit_Fingerprint &scanner) {
+    scanner.system_id = profile.system_id;
+    scanner.capacity = profile.capacity;
+    scanner.security_level = profile.security_level;
+    scanner.packet_len = profile.packet_len;
+    scanner.device_addr = profile.device_addr;
+    scanner.baud_rate = profile.baud_rate;
+}
+
+
+bool sensorProfileMatches(const SensorProfile &a, const SensorProfile &b) {
+    return a.system_id == b.system_id
+        && a.capacity == b.capacity
+        && a.security_level == b.security_level
+        && a.packet_len == b.packet_len
+        && a.device_addr == b.device_addr
+        && a.baud_rate == b.baud_rate;
+}
+
+
+void printSensorProfile(Print &out, const SensorProfile &profile) {
+    out.print("sensor capacity=");
+    out.print(profile.capacity);
+    out.print(" security=");
+    out.print(profile.security_level);
+    out.print(" packet=");
+    out.print(profile.packet_len);
+    out.print(" baud=");
+    out.print(profile.baud_rate);
+    out.print(" addr=0x");
+    out.print(profile.device_addr, HEX);
+    out.print("\n");
+}
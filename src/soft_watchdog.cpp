@@ -0,0 +1,193 @@
+#include "soft_watchdog.h"
+#include "log_level.h"
+
+extern "C" {
+#include "user_interface.h"
+}
+
+// the watchdog a crash is reported for, the last one used.
+static SoftWatchdog *crash_watchdog = nullptr;
+
+
+struct RtcWatch {
+    uint32_t magic;
+    char name[WATCHDOG_NAME];
+};
+
+
+void SoftWatchdog::begin(const char *name, unsigned long budget) {
+    if (depth >= WATCHDOG_DEPTH) {
+        skipped++;
+        return;
+    }
+
+    Watch &watch = watches[depth++];
+    watch.name = name;
+    watch.started = millis();
+    watch.budget = budget;
+    watch.reported = false;
+    crash_watchdog = this;
+}
+
+
+bool SoftWatchdog::expired() {
+    yield();
+    if (depth == 0) {
+        return false;
+    }
+
+    Watch &watch = watches[depth - 1];
+    unsigned long elapsed = millis() - watch.started;
+    if (elapsed < watch.budget) {
+        return false;
+    }
+    if (!watch.reported) {
+        watch.reported = true;
+        log(watch, elapsed);
+        // a long wait is where a hardware watchdog reset is likely.
+        mirror();
+    }
+    return true;
+}
+
+
+bool SoftWatchdog::end() {
+    if (skipped > 0) {
+        skipped--;
+        return false;
+    }
+    if (depth == 0) {
+        return false;
+    }
+
+    Watch &watch = watches[--depth];
+    unsigned long elapsed = millis() - watch.started;
+    if (elapsed < watch.budget) {
+        return false;
+    }
+    if (watch.reported) {
+        // expired() mirrored it, take it out again.
+        mirror();
+    }
+    else {
+        log(watch, elapsed);
+    }
+    return true;
+}
+
+
+void SoftWatchdog::overrun(const char *name, unsigned long budget, unsigned long elapsed) {
+    Watch watch = { name, millis() - elapsed, budget, true };
+    log(watch, elapsed);
+}
+
+
+void SoftWatchdog::log(const Watch &watch, unsigned long elapsed) {
+    Overrun &entry = history[(history_head + history_count) % WATCHDOG_LOG];
+    strncpy(entry.name, watch.name, WATCHDOG_NAME - 1);
+    entry.name[WATCHDOG_NAME - 1] = '\0';
+    entry.budget = watch.budget;
+    entry.elapsed = elapsed;
+    entry.at = millis();
+    if (history_count < WATCHDOG_LOG) {
+        history_count++;
+    }
+    else {
+        history_head = (history_head + 1) % WATCHDOG_LOG;
+    }
+    overruns++;
+
+    LOG_ERROR("\n[i] Watchdog: ");
+    LOG_ERROR(entry.name);
+    LOG_ERROR(" over budget, ");
+    LOG_ERROR(elapsed);
+    LOG_ERROR("/");
+    LOG_ERROR(watch.budget);
+    LOG_ERROR(" ms");
+}
+
+
+void SoftWatchdog::mirror() {
+    readReset();
+    RtcWatch rtc;
+    memset(&rtc, 0, sizeof(rtc));
+    rtc.magic = WATCHDOG_RTC_MAGIC;
+    if (depth > 0) {
+        strncpy(rtc.name, watches[depth - 1].name, WATCHDOG_NAME - 1);
+    }
+    ESP.rtcUserMemoryWrite(WATCHDOG_RTC_OFFSET, (uint32_t *)&rtc, sizeof(rtc));
+}
+
+
+/**
+ * Keep what the previous boot left in RTC memory before this boot first
+ * writes there.
+*/
+void SoftWatchdog::readReset() {
+    if (reset_read) {
+        return;
+    }
+    reset_read = true;
+
+    RtcWatch rtc;
+    ESP.rtcUserMemoryRead(WATCHDOG_RTC_OFFSET, (uint32_t *)&rtc, sizeof(rtc));
+    reset_known = rtc.magic == WATCHDOG_RTC_MAGIC;
+    memcpy(reset_name, rtc.name, WATCHDOG_NAME);
+    reset_name[WATCHDOG_NAME - 1] = '\0';
+}
+
+
+void SoftWatchdog::reportReset(Print &out) {
+    // clears the record, a later reset must not show it again.
+    mirror();
+
+    uint32_t reason = ESP.getResetInfoPtr()->reason;
+    bool crashed = reason == REASON_WDT_RST || reason == REASON_SOFT_WDT_RST
+                   || reason == REASON_EXCEPTION_RST;
+    if (!crashed || !reset_known) {
+        return;
+    }
+
+    out.print("reset reason=");
+    out.print(reason);
+    out.print(" during=");
+    out.print(reset_name[0] ? reset_name : "-");
+    out.print("\n");
+}
+
+
+/**
+ * Called by the core after an exception or a system watchdog reset,
+ * before the restart.
+*/
+extern "C" void custom_crash_callback(struct rst_info *, uint32_t, uint32_t) {
+    if (crash_watchdog) {
+        crash_watchdog->mirror();
+    }
+}
+
+
+void SoftWatchdog::printStats(Print &out) {
+    out.print("watchdog overruns=");
+    out.print(overruns);
+    out.print("\n");
+    for (uint8_t i = 0; i < history_count; i++) {
+        const Overrun &entry = history[(history_head + i) % WATCHDOG_LOG];
+        out.print("overrun ");
+        out.print(entry.name);
+        out.print(" ");
+        out.print(entry.elapsed);
+        out.print("/");
+        out.print(entry.budget);
+        out.print("ms at ");
+        out.print(entry.at);
+        out.print("ms\n");
+    }
+}
+
+
+void SoftWatchdog::resetStats() {
+    overruns = 0;
+    history_head = 0;
+    history_count = 0;
+}
@@ -0,0 +1,277 @@
+#include "transport.h"
+
+
+void Transport::resetStats() {
+    memset(&stats, 0, sizeof(stats));
+}
+
+
+void Transport::printStats(Print &out) {
+    out.print("transport ");
+    out.print(name());
+    out.print(" rx=");
+    out.print(stats.rx_bytes);
+    out.print(" tx=");
+    out.print(stats.tx_bytes);
+    out.print(" rxDropped=");
+    out.print(stats.rx_dropped);
+    out.print(" txDropped=");
+    out.print(stats.tx_dropped);
+    out.print(" rxPeak=");
+    out.print(stats.rx_peak);
+    out.print(" txPeak=");
+    out.print(stats.tx_peak);
+    out.print("\n");
+}
+
+
+void Transport::stampArrived(size_t len) {
+    if (len == 0) {
+        return;
+    }
+    stamped += len;
+    if (stamp_count == TRANSPORT_STAMPS) {
+        stamps[(stamp_head + stamp_count - 1) % TRANSPORT_STAMPS].bytes += len;
+        return;
+    }
+    RxBatch &batch = stamps[(stamp_head + stamp_count) % TRANSPORT_STAMPS];
+    batch.at = micros();
+    batch.bytes = len;
+    stamp_count++;
+}
+
+
+void Transport::stampRead() {
+    if (stamp_count == 0) {
+        return;
+    }
+    stamped--;
+    if (--stamps[stamp_head].bytes == 0) {
+        stamp_head = (stamp_head + 1) % TRANSPORT_STAMPS;
+        stamp_count--;
+    }
+}
+
+
+void Transport::clearStamps() {
+    stamp_head = 0;
+    stamp_count = 0;
+    stamped = 0;
+}
+
+
+bool WiFiTransport::connect(const char *host, uint16_t port) {
+    return tcp.connect(host, port);
+}
+
+
+bool WiFiTransport::connected() {
+    return tcp.connected();
+}
+
+
+void WiFiTransport::stop() {
+    tcp.stop();
+    clearStamps();
+}
+
+
+/**
+ * Polled, the arrival time of new bytes is when a poll first sees them.
+*/
+int WiFiTransport::available() {
+    int n = tcp.available();
+    if (n > 0 && (size_t)n > stamped) {
+        stampArrived(n - stamped);
+    }
+    if (n > stats.rx_peak) {
+        stats.rx_peak = n;
+    }
+    return n;
+}
+
+
+int WiFiTransport::read() {
+    int c = tcp.read();
+    if (c >= 0) {
+        stats.rx_bytes++;
+        stampRead();
+    }
+    return c;
+}
+
+
+int WiFiTransport::peek() {
+    return tcp.peek();
+}
+
+
+size_t WiFiTransport::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+
+size_t WiFiTransport::write(const uint8_t *buffer, size_t size) {
+    size_t n = tcp.write(buffer, size);
+    stats.tx_bytes += n;
+    stats.tx_dropped += size - n;
+    return n;
+}
+
+
+int WiFiTransport::availableForWrite() {
+    return tcp.availableForWrite();
+}
+
+
+void WiFiTransport::flush() {
+    tcp.flush();
+}
+
+
+#ifdef TRANSPORT_ASYNC
+
+AsyncTransport::AsyncTransport() {
+    tcp.onConnect([](void *arg, AsyncClient *) {
+        AsyncTransport *self = (AsyncTransport *)arg;
+        self->connecting = false;
+        self->is_connected = true;
+    }, this);
+
+    tcp.onDisconnect([](void *arg, AsyncClient *) {
+        AsyncTransport *self = (AsyncTransport *)arg;
+        self->connecting = false;
+        self->is_connected = false;
+    }, this);
+
+    tcp.onError([](void *arg, AsyncClient *, int8_t) {
+        ((AsyncTransport *)arg)->connecting = false;
+    }, this);
+
+    tcp.onData([](void *arg, AsyncClient *, void *data, size_t len) {
+        ((AsyncTransport *)arg)->receive((const uint8_t *)data, len);
+    }, this);
+
+    // acknowledged data frees send window, so does the periodic poll.
+    tcp.onAck([](void *arg, AsyncClient *, size_t, uint32_t) {
+        ((AsyncTransport *)arg)->drain();
+    }, this);
+
+    tcp.onPoll([](void *arg, AsyncClient *) {
+        ((AsyncTransport *)arg)->drain();
+    }, this);
+}
+
+
+bool AsyncTransport::connect(const char *host, uint16_t port) {
+    if (is_connected) {
+        return true;
+    }
+    if (!connecting) {
+        connecting = tcp.connect(host, port);
+    }
+    return false;
+}
+
+
+bool AsyncTransport::connected() {
+    return is_connected;
+}
+
+
+void AsyncTransport::stop() {
+    tcp.close(true);
+    is_connected = false;
+    connecting = false;
+    rx.drop(rx.count);
+    tx.drop(tx.count);
+    clearStamps();
+}
+
+
+void AsyncTransport::receive(const uint8_t *data, size_t len) {
+    size_t n = rx.push(data, len);
+    stampArrived(n);
+    stats.rx_bytes += n;
+    stats.rx_dropped += len - n;
+    if (rx.count > stats.rx_peak) {
+        stats.rx_peak = rx.count;
+    }
+}
+
+
+void AsyncTransport::drain() {
+    while (tx.count > 0 && is_connected && tcp.canSend()) {
+        size_t n = tx.span();
+        if (n > tcp.space()) {
+            n = tcp.space();
+        }
+        if (n == 0) {
+            break;
+        }
+        n = tcp.add((const char *)&tx.data[tx.head], n);
+        if (n == 0) {
+            break;
+        }
+        tx.drop(n);
+        tcp.send();
+    }
+}
+
+
+int AsyncTransport::available() {
+    return rx.count;
+}
+
+
+int AsyncTransport::read() {
+    if (rx.count == 0) {
+        return -1;
+    }
+    uint8_t c = rx.data[rx.head];
+    rx.drop(1);
+    stampRead();
+    return c;
+}
+
+
+int AsyncTransport::peek() {
+    return rx.count ? rx.data[rx.head] : -1;
+}
+
+
+size_t AsyncTransport::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+
+size_t AsyncTransport::write(const uint8_t *buffer, size_t size) {
+    size_t n = tx.push(buffer, size);
+    stats.tx_bytes += n;
+    stats.tx_dropped += size - n;
+    if (tx.count > stats.tx_peak) {
+        stats.tx_peak = tx.count;
+    }
+    drain();
+    return n;
+}
+
+
+int AsyncTransport::availableForWrite() {
+    return TRANSPORT_TX_SIZE - tx.count;
+}
+
+
+/**
+ * Hand everything queued to TCP, used before closing the link.
+*/
+void AsyncTransport::flush() {
+    unsigned long started = millis();
+    drain();
+    while (tx.count > 0 && is_connected && millis() - started < TRANSPORT_FLUSH_TIMEOUT) {
+        yield();
+        drain();
+    }
+}
+
+#endif